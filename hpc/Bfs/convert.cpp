@@ -0,0 +1,32 @@
+//to run code
+//g++ -fopenmp convert.cpp -o convert
+//./convert input.txt input.bin [--directed]
+
+#include <iostream>
+#include <string>
+
+#include "graph.hpp"
+
+// Convert an edge list file into the binary graph format, which the benchmarks
+// load with mmap instead of parsing text on every run
+int main(int argc, const char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <edge_list> <output.bin> [--directed]\n";
+        return 1;
+    }
+
+    bool directed = argc > 3 && std::string(argv[3]) == "--directed";
+
+    try {
+        Graph graph = import_graph(argv[1], directed);
+        save_graph(graph, argv[2]);
+
+        std::cout << "Wrote " << graph.n_nodes() << " nodes and " << graph.n_edges()
+                  << " edges to " << argv[2] << "\n";
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,34 +1,346 @@
 #pragma once
 
+#include <fcntl.h>
 #include <omp.h>
-
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <queue>
-#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 #include <algorithm>
+#include <array>
+
+// Set of visited nodes shared between threads, one bit per node.
+//
+// Bits are packed in 64-bit atomic words: testing is a plain atomic load and
+// setting is a single `fetch_or`, so no lock is ever taken and threads only
+// contend when they touch nodes of the same word at the same time.
+struct VisitedBitmap {
+    explicit VisitedBitmap(int n) : words((n + 63) / 64) { reset(); }
+
+    // Returns if a node is visited
+    bool test(int node) const {
+        return words[node / 64].load(std::memory_order_relaxed) & mask(node);
+    }
 
-// Generic representation of a graph implemented with an adjacency matrix
-struct Graph {
+    // Marks a node as visited
+    void set(int node) { words[node / 64].fetch_or(mask(node), std::memory_order_relaxed); }
+
+    // Marks a node as visited and returns if it already was
+    bool test_and_set(int node) {
+        // Skip the read-modify-write when the bit is already there
+        if (test(node)) return true;
+        return words[node / 64].fetch_or(mask(node), std::memory_order_acq_rel) & mask(node);
+    }
+
+    // Marks every node as not visited
+    void reset() {
+        for (auto& word : words) word.store(0, std::memory_order_relaxed);
+    }
+
+   private:
+    static std::uint64_t mask(int node) { return std::uint64_t(1) << (node % 64); }
+
+    std::vector<std::atomic<std::uint64_t>> words;
+};
+
+// Monotone priority queue for integer keys (Ahuja et al.).
+//
+// Only valid when popped keys never decrease, as in Dijkstra. Entries live in
+// 33 buckets by the highest bit in which their key differs from the last key
+// popped; when bucket 0 runs dry, the lowest non-empty bucket is redistributed
+// around its minimum, and every entry moves at most 32 times.
+template <typename Value>
+struct RadixHeap {
+    using Key = std::uint32_t;
+
+    bool empty() const { return count == 0; }
+
+    // Remove every entry, keeping the bucket buffers
+    void clear() {
+        for (auto& bucket : buckets) bucket.clear();
+        last = 0;
+        count = 0;
+    }
+
+    // Insert a value, `key` must not be lower than the last key popped
+    void push(Key key, Value value) {
+        buckets[bucket_of(key)].emplace_back(key, value);
+        count++;
+    }
+
+    // Remove and return an entry with the lowest key
+    std::pair<Key, Value> pop() {
+        if (buckets[0].empty()) {
+            size_t i = 1;
+            while (buckets[i].empty()) i++;
+
+            last = std::min_element(buckets[i].begin(), buckets[i].end())->first;
+            for (const auto& entry : buckets[i]) buckets[bucket_of(entry.first)].push_back(entry);
+            buckets[i].clear();
+        }
+
+        auto entry = buckets[0].back();
+        buckets[0].pop_back();
+        count--;
+
+        return entry;
+    }
+
+   private:
+    size_t bucket_of(Key key) const { return key == last ? 0 : 32 - __builtin_clz(key ^ last); }
+
+    std::array<std::vector<std::pair<Key, Value>>, 33> buckets;
+    Key last = 0;
+    size_t count = 0;
+};
+
+// Buffers of a multi-source BFS, kept between batches so that running many
+// batches does not allocate
+struct MsBfsScratch {
+    // Per node masks of the sources that reached it, that reached it at the
+    // current level, and that reach it at the next level
+    std::vector<std::uint64_t> seen;
+    std::vector<std::uint64_t> frontier;
+    std::vector<std::uint64_t> next;
+
+    // Queries of the current batch, as linked lists indexed by destination
+    std::vector<int> query_head;
+    std::vector<int> query_next;
+};
+
+// Per-node state and scratch buffers of a traversal, reused between calls so
+// that repeated queries do not allocate.
+//
+// Every entry is stamped with the generation of the traversal that wrote it,
+// and entries of older generations read as not reached. Starting a traversal
+// bumps the generation instead of clearing the arrays, so its cost only
+// depends on the nodes it touches.
+struct TraversalWorkspace {
     using Node = int;
 
+    // Start a new traversal over a graph of `n` nodes
+    void begin(int n) {
+        if (n > int(stamps.size())) {
+            stamps = std::vector<std::atomic<std::uint32_t>>(n);
+            parents.resize(n);
+            distances.resize(n);
+            generation = 0;
+        }
+
+        // Only clear the stamps when the generation wraps around
+        if (++generation == 0) {
+            for (auto& stamp : stamps) stamp.store(0, std::memory_order_relaxed);
+            generation = 1;
+        }
+    }
+
+    // Returns if a node was reached by the current traversal
+    bool reached(Node node) const { return stamps[node].load(std::memory_order_relaxed) == generation; }
+
+    // Returns the node a node was reached from, -1 if it was not reached
+    Node parent(Node node) const { return reached(node) ? parents[node] : -1; }
+
+    // Returns the distance (hops or cost) of a node, -1 if it was not reached
+    int distance(Node node) const { return reached(node) ? distances[node] : -1; }
+
+    // Record the parent and distance of a node
+    void reach(Node node, Node parent, int distance) {
+        stamps[node].store(generation, std::memory_order_relaxed);
+        parents[node] = parent;
+        distances[node] = distance;
+    }
+
+    // Mark a node as reached if no other thread did it first, returns if this
+    // thread won. The caller then records the parent and distance with `set`.
+    bool claim(Node node) {
+        std::uint32_t stamp = stamps[node].load(std::memory_order_relaxed);
+        return stamp != generation && stamps[node].compare_exchange_strong(stamp, generation);
+    }
+
+    // Record the parent and distance of a node already reached
+    void set(Node node, Node parent, int distance) {
+        parents[node] = parent;
+        distances[node] = distance;
+    }
+
+    // Returns the parent of every node, as a vector
+    std::vector<Node> parent_array(int n) const {
+        std::vector<Node> result(n);
+        for (Node node = 0; node < n; node++) result[node] = parent(node);
+        return result;
+    }
+
+    // Returns the distance of every node, as a vector
+    std::vector<int> distance_array(int n) const {
+        std::vector<int> result(n);
+        for (Node node = 0; node < n; node++) result[node] = distance(node);
+        return result;
+    }
+
+    // Scratch buffers, their content is only meaningful inside a traversal
+    std::vector<Node> frontier, next_frontier, queue;
+    std::vector<std::pair<Node, Node>> stack;
+    std::vector<std::pair<int, Node>> heap;
+    RadixHeap<Node> radix_heap;
+    std::vector<char> in_frontier, in_next_frontier;
+    std::vector<std::vector<Node>> buckets;
+
+    // Nodes a shortest path kernel offered a cost above INT_MAX, see
+    // `check_costs`
+    std::vector<Node> overflowed;
+
+    // Packed (cost, origin) of every node for `p_dijkstra`. Entries are put
+    // back to "unreached" after every run, so it is only filled once.
+    std::vector<std::atomic<std::uint64_t>> best;
+
+   private:
+    std::uint32_t generation = 0;
+    // Atomic since threads claim nodes concurrently, see `claim`
+    std::vector<std::atomic<std::uint32_t>> stamps;
+    std::vector<Node> parents;
+    std::vector<int> distances;
+};
+
+// Generic representation of a graph implemented in compressed sparse row (CSR)
+// form.
+//
+// The neighbors of a node are stored contiguously in `targets`, between
+// `offsets[node]` and `offsets[node + 1]`, and the weight of each edge sits at
+// the same position in `weights`. Traversals only touch existing edges, so
+// both time and memory are O(V + E) instead of O(V^2).
+//
+// The arrays are read-only views: they either point into buffers built by
+// `from_edges` or straight into a memory mapped binary file (see `mmap_graph`),
+// so a graph stored on disk is traversed in place without being parsed.
+struct Graph {
+    using Node = int;
+    using Offset = std::int64_t;
+
+    // Weighted directed edge, used to build the graph
+    struct Edge {
+        Node src;
+        Node dst;
+        int weight;
+    };
+
+    // Contiguous, read-only view over a slice of one of the CSR arrays
+    template <typename T>
+    struct Range {
+        const T* first;
+        const T* last;
+
+        const T* begin() const { return first; }
+        const T* end() const { return last; }
+        Offset size() const { return last - first; }
+        const T& operator[](Offset i) const { return first[i]; }
+    };
+
+    // Private stack size above which a thread of `p_rdfs` shares half of its
+    // pending nodes with idle threads
     int task_threshold = 60;
+
+    // Recursion depth above which `rdfs` falls back to the iterative version
     int max_depth_rdfs = 10'000;
 
-    std::vector<std::vector<int>> adj_matrix;
+    // Direction-optimizing BFS switches to bottom-up once the frontier edges
+    // exceed 1/bfs_alpha of the unexplored edges, and back to top-down once
+    // the frontier shrinks below 1/bfs_beta of the nodes
+    int bfs_alpha = 15;
+    int bfs_beta = 18;
+
+    const Offset* offsets = nullptr;
+    const Node* targets = nullptr;
+    const int* weights = nullptr;
+
+    int node_count = 0;
+    Offset edge_count = 0;
+
+    // False when every edge is stored in both directions, which lets
+    // traversals use out-neighbors as in-neighbors
+    bool directed = true;
+
+    // Keeps the memory behind the CSR arrays alive, shared between copies
+    std::shared_ptr<const void> storage;
+
+    // Build a graph with `n` nodes from a list of directed edges. Pass
+    // `directed = false` if the list already holds both directions of every
+    // edge.
+    //
+    // Edges are bucketed by source with a counting sort, then every adjacency
+    // list is sorted by target so that `edge_exists` can binary search it.
+    static Graph from_edges(int n, const std::vector<Edge>& edges, bool directed = true) {
+        auto csr = std::make_shared<CsrBuffers>();
+        csr->offsets.assign(n + 1, 0);
+        csr->targets.resize(edges.size());
+        csr->weights.resize(edges.size());
+
+        for (const auto& edge : edges) csr->offsets[edge.src + 1]++;
+        for (int node = 0; node < n; node++) csr->offsets[node + 1] += csr->offsets[node];
+
+        std::vector<Offset> cursor(csr->offsets.begin(), csr->offsets.end() - 1);
+        for (const auto& edge : edges) {
+            Offset pos = cursor[edge.src]++;
+            csr->targets[pos] = edge.dst;
+            csr->weights[pos] = edge.weight;
+        }
+
+        sort_adjacency(*csr);
+
+        Graph graph;
+        graph.offsets = csr->offsets.data();
+        graph.targets = csr->targets.data();
+        graph.weights = csr->weights.data();
+        graph.node_count = n;
+        graph.edge_count = edges.size();
+        graph.directed = directed;
+        graph.storage = std::move(csr);
+
+        return graph;
+    }
+
+    // Returns the neighbors of a node
+    Range<Node> neighbors(Node node) const {
+        return {targets + offsets[node], targets + offsets[node + 1]};
+    }
+
+    // Returns the weights of the edges leaving a node, in the same order as
+    // `neighbors`
+    Range<int> edge_weights(Node node) const {
+        return {weights + offsets[node], weights + offsets[node + 1]};
+    }
 
     // Returns if an edge between two nodes exists
-    bool edge_exists(Node n1, Node n2) { return adj_matrix[n1][n2] > 0; }
+    bool edge_exists(Node n1, Node n2) const {
+        auto adj = neighbors(n1);
+        return std::binary_search(adj.begin(), adj.end(), n2);
+    }
+
+    // Returns the number of outgoing edges of a node
+    Offset degree(Node node) const { return offsets[node + 1] - offsets[node]; }
 
     // Returns the number of nodes of the graph
-    int n_nodes() { return adj_matrix.size(); }
+    int n_nodes() const { return node_count; }
+
+    // Returns the number of edges of the graph
+    Offset n_edges() const { return edge_count; }
 
     // Returns the number of nodes of the graph
-    int size() { return n_nodes(); }
+    int size() const { return n_nodes(); }
 
     // Sequential implementation of the iterative version of depth first search.
     void dfs(Node src, std::vector<int>& visited) {
@@ -41,9 +353,30 @@ struct Graph {
             if (!visited[node]) {
                 visited[node] = true;
 
-                for (int next_node = 0; next_node < n_nodes(); next_node++)
-                    if (edge_exists(node, next_node) && !visited[next_node])
-                        queue.push_back(next_node);
+                for (Node next_node : neighbors(node))
+                    if (!visited[next_node]) queue.push_back(next_node);
+            }
+        }
+    }
+
+    // Sequential implementation of the iterative version of depth first
+    // search, recording in `ws` the parent and depth of every node in the
+    // search tree.
+    void dfs(Node src, TraversalWorkspace& ws) {
+        ws.begin(size());
+
+        auto& stack = ws.stack;
+        stack.assign(1, {src, src});
+
+        while (!stack.empty()) {
+            auto [node, parent] = stack.back();
+            stack.pop_back();
+
+            if (!ws.reached(node)) {
+                ws.reach(node, parent, node == src ? 0 : ws.distance(parent) + 1);
+
+                for (Node next_node : neighbors(node))
+                    if (!ws.reached(next_node)) stack.emplace_back(next_node, node);
             }
         }
     }
@@ -52,8 +385,8 @@ struct Graph {
     void rdfs(Node src, std::vector<int>& visited, int depth = 0) {
         visited[src] = true;
 
-        for (int node = 0; node < n_nodes(); node++) {
-            if (edge_exists(src, node) && !visited[node]) {
+        for (Node node : neighbors(src)) {
+            if (!visited[node]) {
                 // Limit recursion depth to avoid stack overflow error
                 if (depth <= max_depth_rdfs)
                     rdfs(node, visited, depth + 1);
@@ -79,6 +412,8 @@ struct Graph {
             if (!visited[node]) {
                 visited[node] = true;
 
+                auto adj = neighbors(node);
+
 #pragma omp parallel shared(queue, visited)
                 {
                     // Every thread has a private_queue to avoid continuous lock
@@ -86,9 +421,8 @@ struct Graph {
                     std::vector<Node> private_queue;
 
 #pragma omp for nowait schedule(static)
-                    for (int next_node = 0; next_node < n_nodes(); next_node++)
-                        if (edge_exists(node, next_node) && !visited[next_node])
-                            private_queue.push_back(next_node);
+                    for (Offset i = 0; i < adj.size(); i++)
+                        if (!visited[adj[i]]) private_queue.push_back(adj[i]);
 
 // Append at the end of master queue the private queue of the thread
 #pragma omp critical(queue_update)
@@ -105,28 +439,19 @@ struct Graph {
     // threads have a private queue where neighbors still not visited are added.
     // At the end, threads concatenate their private queue to the main queue.
     //
-    // **Important**: this version implements node level locks.
-    void p_dfs_with_locks(Node src, std::vector<int>& visited,
-                          std::vector<omp_lock_t>& node_locks) {
-        // Note: Since C++11, different elements in the same container can be
-        // modified concurrently by different threads, except for the elements
-        // of std::vector<bool>
-        //
-        // Possible explanation of why here:
-        // https://stackoverflow.com/a/33617530/2691946
-        //
-        // This is why we use a vector of int.
-
+    // **Important**: this version tracks visited nodes with an atomic bitmap,
+    // so it can run while other threads traverse the same graph.
+    void p_dfs_atomic(Node src, VisitedBitmap& visited) {
         std::vector<Node> queue{src};
 
         while (!queue.empty()) {
             Node node = queue.back();
             queue.pop_back();
 
-            bool already_visited = atomic_test_visited(node, visited, &node_locks[node]);
-
-            if (!already_visited) {
-                atomic_set_visited(node, visited, &node_locks[node]);
+            // Test and set in a single step, so a node reached by two threads
+            // at the same time is only expanded by one of them
+            if (!visited.test_and_set(node)) {
+                auto adj = neighbors(node);
 
 #pragma omp parallel shared(queue, visited)
                 {
@@ -135,16 +460,8 @@ struct Graph {
                     std::vector<Node> private_queue;
 
 #pragma omp for nowait
-                    for (int next_node = 0; next_node < n_nodes(); next_node++) {
-                        // Check if the edge exists is a non-blocking request,
-                        // so it's better to do it before than checking if the
-                        // node is already visited
-                        if (edge_exists(node, next_node)) {
-                            if (atomic_test_visited(next_node, visited, &node_locks[next_node])) {
-                                private_queue.push_back(next_node);
-                            }
-                        }
-                    }
+                    for (Offset i = 0; i < adj.size(); i++)
+                        if (!visited.test(adj[i])) private_queue.push_back(adj[i]);
 
 // Append at the end of master queue the private queue of the thread
 #pragma omp critical(queue_update)
@@ -156,163 +473,469 @@ struct Graph {
 
     // Parallel implementation of the recursive version of depth first search.
     //
-    // This version automatically initialize locks
+    // Nodes already set in `visited` are skipped, and every node reached is set
+    // on return.
     void p_rdfs(Node src, std::vector<int>& visited) {
-        // Initialize locks
-        std::vector<omp_lock_t> node_locks;
-        node_locks.reserve(size());
+        VisitedBitmap bitmap(size());
 
-        for (int node = 0; node < n_nodes(); node++) {
-            omp_lock_t lock;
-            node_locks[node] = lock;
-            omp_init_lock(&(node_locks[node]));
-        }
+#pragma omp parallel for
+        for (int node = 0; node < n_nodes(); node++)
+            if (visited[node]) bitmap.set(node);
+
+        p_rdfs(src, bitmap);
+
+#pragma omp parallel for
+        for (int node = 0; node < n_nodes(); node++) visited[node] = bitmap.test(node);
+    }
 
-#pragma omp parallel shared(src, visited, node_locks)
+    // Parallel implementation of depth first search with work stealing,
+    // tracking visited nodes with an atomic bitmap.
+    //
+    // A single parallel region runs the whole traversal. Every thread walks
+    // the graph depth first from a private stack, claiming nodes with a
+    // test-and-set as it pushes them. When the stack grows beyond
+    // `task_threshold`, its oldest half (the roots of the largest unexplored
+    // subtrees) moves to the thread's deque. Threads with nothing left pop
+    // their own deque first, then steal half of another thread's deque from
+    // the opposite end. The traversal ends once every thread is idle, which
+    // also means every deque is empty.
+    void p_rdfs(Node src, VisitedBitmap& visited) {
+        if (visited.test_and_set(src)) return;
+
+        int n_threads = omp_get_max_threads();
+        std::vector<WorkDeque> deques(n_threads);
+        deques[0].push(src);
+
+        // Number of threads that found no work, and are not trying to steal
+        std::atomic<int> idle_threads{0};
+
+#pragma omp parallel num_threads(n_threads) shared(deques, visited, idle_threads)
+        {
+            // Fewer threads than requested may be available
 #pragma omp single
-        p_rdfs(src, visited, node_locks);
-
-        // Destory locks
-        for (int node = 0; node < n_nodes(); node++) omp_destroy_lock(&(node_locks[node]));
-    }
-
-    // Parallel implementation of the recursive version of depth first search,
-    // full version with locks
-    void p_rdfs(Node src, std::vector<int>& visited, std::vector<omp_lock_t>& node_locks,
-                int depth = 0) {
-        atomic_set_visited(src, visited, &node_locks[src]);
-
-        // Number of tasks in parallel executing at this level of depth
-        int task_count = 0;
-
-        for (int node = 0; node < n_nodes(); node++) {
-            if (edge_exists(src, node) && !atomic_test_visited(node, visited, &node_locks[node])) {
-                // Limit the number of parallel tasks both horizontally (for
-                // checking neighbors) and vertically (between recursive
-                // calls).
-                //
-                // Fallback to iterative version if one of these limits are
-                // reached
-                if (depth <= max_depth_rdfs && task_count <= task_threshold) {
-                    task_count++;
-
-#pragma omp task untied default(shared) firstprivate(node)
-                    {
-                        p_rdfs(node, visited, node_locks, depth + 1);
-                        task_count--;
+            n_threads = omp_get_num_threads();
+
+            int tid = omp_get_thread_num();
+            std::vector<Node> stack;
+
+            while (true) {
+                if (stack.empty() && !deques[tid].pop(stack)) {
+                    idle_threads++;
+
+                    bool stolen = false;
+                    while (!stolen && idle_threads.load() < n_threads) {
+                        // Leave the idle count while stealing, so nobody sees
+                        // every thread idle while a stolen batch is in flight
+                        idle_threads--;
+                        for (int i = 1; i < n_threads && !stolen; i++)
+                            stolen = deques[(tid + i) % n_threads].steal(stack);
+                        if (!stolen) {
+                            idle_threads++;
+                            std::this_thread::yield();
+                        }
                     }
 
-                } else {
-                    // Fallback to parallel iterative version
-                    p_dfs_with_locks(node, visited, node_locks);
+                    if (!stolen) break;
                 }
+
+                Node node = stack.back();
+                stack.pop_back();
+
+                for (Node next : neighbors(node))
+                    if (!visited.test_and_set(next)) stack.push_back(next);
+
+                if (int(stack.size()) > task_threshold && deques[tid].empty())
+                    deques[tid].share(stack);
             }
         }
+    }
+
+    // Sequential implementation of breadth first search.
+    //
+    // Returns the level (distance in hops from the source) and the parent of
+    // every node, -1 for nodes that are not reachable.
+    std::pair<std::vector<int>, std::vector<Node>> bfs(Node src) {
+        TraversalWorkspace ws;
+        bfs(src, ws);
+
+        return std::make_pair(ws.distance_array(size()), ws.parent_array(size()));
+    }
+
+    // Sequential implementation of breadth first search, recording the level
+    // and parent of every node in `ws`
+    void bfs(Node src, TraversalWorkspace& ws) {
+        ws.begin(size());
+        ws.reach(src, src, 0);
+
+        auto& queue = ws.queue;
+        queue.assign(1, src);
 
-#pragma omp taskwait
+        for (size_t head = 0; head < queue.size(); head++) {
+            Node node = queue[head];
+
+            for (Node next : neighbors(node)) {
+                if (!ws.reached(next)) {
+                    ws.reach(next, node, ws.distance(node) + 1);
+                    queue.push_back(next);
+                }
+            }
+        }
     }
 
-    // Serial implementation of the Dijkstra algorithm without early exit condition.
+    // Parallel level-synchronous implementation of breadth first search.
+    //
+    // Every level expands the whole frontier in parallel. Small frontiers are
+    // expanded top-down: each frontier node claims its unvisited neighbors
+    // with an atomic compare and swap. Once the frontier gets large, most of
+    // those edges lead to nodes already visited, so it switches to bottom-up:
+    // each unvisited node looks for any parent in the frontier and stops at
+    // the first one (Beamer et al., "Direction-Optimizing Breadth-First
+    // Search"). Bottom-up needs in-neighbors, so it is only used on undirected
+    // graphs.
     //
-    // Note: It does not use a priority queue.
-    std::pair<std::vector<Node>, std::vector<Node>> dijkstra(Node src) {
-        std::vector<Node> queue;
-        queue.push_back(src);
+    // Returns levels and parents, as `bfs`.
+    std::pair<std::vector<int>, std::vector<Node>> p_bfs(Node src) {
+        TraversalWorkspace ws;
+        p_bfs(src, ws);
 
-        std::vector<Node> came_from(size(), -1);
-        std::vector<Node> cost_so_far(size(), -1);
+        return std::make_pair(ws.distance_array(size()), ws.parent_array(size()));
+    }
 
-        came_from[src] = src;
-        cost_so_far[src] = 0;
+    // Parallel breadth first search, recording the level and parent of every
+    // node in `ws`
+    void p_bfs(Node src, TraversalWorkspace& ws) {
+        ws.begin(size());
+        ws.reach(src, src, 0);
 
-        while (!queue.empty()) {
-            Node current = queue.back();
-            queue.pop_back();
+        auto& frontier = ws.frontier;
+        auto& next_frontier = ws.next_frontier;
+        frontier.assign(1, src);
+
+        // Frontier as a dense bitmap, only maintained while going bottom-up
+        auto& in_frontier = ws.in_frontier;
+        auto& in_next_frontier = ws.in_next_frontier;
+
+        Offset frontier_edges = degree(src);
+        Offset unexplored_edges = n_edges();
+        bool bottom_up = false;
+
+        for (int level = 1; !frontier.empty(); level++) {
+            unexplored_edges -= frontier_edges;
+
+            if (!bottom_up && !directed && frontier_edges > unexplored_edges / bfs_alpha) {
+                bottom_up = true;
+                frontier_to_bitmap(frontier, in_frontier);
+            } else if (bottom_up && Offset(frontier.size()) * bfs_beta < size()) {
+                bottom_up = false;
+            }
+
+            next_frontier.clear();
 
-            for (int next = 0; next < n_nodes(); next++) {
-                if (edge_exists(current, next)) {
-                    int new_cost = cost_so_far[current] + adj_matrix[current][next];
+            if (bottom_up) {
+                frontier_edges =
+                    bfs_bottom_up_step(level, in_frontier, in_next_frontier, next_frontier, ws);
+                std::swap(in_frontier, in_next_frontier);
+            } else {
+                frontier_edges = bfs_top_down_step(level, frontier, next_frontier, ws);
+            }
 
-                    if (cost_so_far[next] == -1 || new_cost < cost_so_far[next]) {
-                        cost_so_far[next] = new_cost;
-                        queue.push_back(next);
-                        came_from[next] = current;
+            std::swap(frontier, next_frontier);
+        }
+    }
+
+    // Maximum number of sources of a single `ms_bfs` batch, one per bit
+    static constexpr int ms_bfs_width = 64;
+
+    // Parallel multi-source breadth first search (Then et al., "The More the
+    // Merrier: Efficient Multi-Source Graph Traversal").
+    //
+    // Runs up to `ms_bfs_width` BFS at once. Every node keeps a 64-bit mask of
+    // the sources that have reached it, so one pass over an edge advances all
+    // the searches that share it. For every node and level, calls
+    // `visit(node, reached, level)` with the mask of the sources that reach
+    // the node at that level; `visit` is called from several threads at once.
+    //
+    // Buffers come from `scratch` and are reused across batches.
+    template <typename Visit>
+    void ms_bfs(const std::vector<Node>& sources, MsBfsScratch& scratch, Visit visit) {
+        int count = std::min<int>(sources.size(), ms_bfs_width);
+
+        auto& seen = scratch.seen;
+        auto& frontier = scratch.frontier;
+        auto& next = scratch.next;
+
+        seen.assign(size(), 0);
+        frontier.assign(size(), 0);
+        next.assign(size(), 0);
+
+        for (int i = 0; i < count; i++) {
+            seen[sources[i]] |= std::uint64_t(1) << i;
+            frontier[sources[i]] |= std::uint64_t(1) << i;
+        }
+
+        for (int i = 0; i < count; i++) visit(sources[i], std::uint64_t(1) << i, 0);
+
+        for (int level = 1;; level++) {
+            bool reached_any = false;
+
+#pragma omp parallel
+            {
+                // Push every frontier mask to the neighbors
+#pragma omp for schedule(dynamic, 1024)
+                for (Node node = 0; node < size(); node++) {
+                    std::uint64_t mask = frontier[node];
+                    if (!mask) continue;
+
+                    for (Node neighbor : neighbors(node)) {
+                        if ((seen[neighbor] & mask) == mask) continue;
+
+#pragma omp atomic
+                        next[neighbor] |= mask;
+                    }
+                }
+
+                // Keep only the sources that reach a node for the first time
+#pragma omp for schedule(static) reduction(|| : reached_any)
+                for (Node node = 0; node < size(); node++) {
+                    std::uint64_t reached = next[node] & ~seen[node];
+                    next[node] = 0;
+                    frontier[node] = reached;
+
+                    if (reached) {
+                        seen[node] |= reached;
+                        reached_any = true;
+                        visit(node, reached, level);
                     }
                 }
             }
-        }
 
-        return std::make_pair(came_from, cost_so_far);
+            if (!reached_any) break;
+        }
     }
 
-    inline std::vector<omp_lock_t> initialize_locks() {
-        std::vector<omp_lock_t> node_locks;
-        node_locks.reserve(n_nodes());
+    // Answer many hop distance queries, given as (source, destination) pairs,
+    // by running `ms_bfs` over batches of up to `ms_bfs_width` distinct
+    // sources.
+    //
+    // Returns the number of edges on a shortest path for every query, -1 when
+    // the destination is not reachable.
+    std::vector<int> batch_hop_distances(const std::vector<std::pair<Node, Node>>& queries,
+                                         MsBfsScratch& scratch) {
+        std::vector<int> distances(queries.size(), -1);
+
+        // Queries grouped by source
+        std::vector<int> order(queries.size());
+        for (size_t q = 0; q < queries.size(); q++) order[q] = q;
+        std::sort(order.begin(), order.end(),
+                  [&](int a, int b) { return queries[a].first < queries[b].first; });
+
+        // Queries of the batch indexed by destination, as linked lists
+        auto& query_head = scratch.query_head;
+        auto& query_next = scratch.query_next;
+        query_head.assign(size(), -1);
+        query_next.assign(queries.size(), -1);
+
+        std::vector<Node> sources;
+        std::vector<std::uint64_t> query_bit(queries.size());
+
+        for (size_t first = 0; first < order.size();) {
+            // Take the queries of the next `ms_bfs_width` distinct sources
+            sources.clear();
+            size_t last = first;
+
+            for (; last < order.size(); last++) {
+                Node src = queries[order[last]].first;
+
+                if (sources.empty() || sources.back() != src) {
+                    if (int(sources.size()) == ms_bfs_width) break;
+                    sources.push_back(src);
+                }
+
+                int q = order[last];
+                query_bit[q] = std::uint64_t(1) << (sources.size() - 1);
+                query_next[q] = query_head[queries[q].second];
+                query_head[queries[q].second] = q;
+            }
+
+            ms_bfs(sources, scratch, [&](Node node, std::uint64_t reached, int level) {
+                for (int q = query_head[node]; q != -1; q = query_next[q])
+                    if (reached & query_bit[q]) distances[q] = level;
+            });
 
-        for (int node = 0; node < n_nodes(); node++) {
-            omp_lock_t lock;
-            node_locks[node] = lock;
-            omp_init_lock(&(node_locks[node]));
+            // Only reset what this batch touched
+            for (size_t i = first; i < last; i++) query_head[queries[order[i]].second] = -1;
+
+            first = last;
         }
 
-        return node_locks;
+        return distances;
     }
 
-    // Parallel implementation of the Dijkstra algorithm without early exit
-    // condition using node level locks. As expected, it performs very poorly
+    // Serial implementation of the Dijkstra algorithm with a binary heap.
     //
-    // Note: It does not use a priority queue.
-    std::pair<std::vector<Node>, std::vector<Node>> p_dijkstra(Node src) {
-        std::vector<Node> queue;
-        queue.push_back(src);
+    // If `target` is given, stops as soon as its cost is final. Returns, for
+    // every node, the node it is reached from and the cost of the shortest
+    // path from the source (-1 for nodes not reached). Weights must be
+    // non-negative, and a node whose cost does not fit in an int throws
+    // std::overflow_error.
+    std::pair<std::vector<Node>, std::vector<Node>> dijkstra(Node src, Node target = -1) {
+        TraversalWorkspace ws;
+        dijkstra(src, ws, target);
+
+        return std::make_pair(ws.parent_array(size()), ws.distance_array(size()));
+    }
+
+    // Serial implementation of the Dijkstra algorithm with a binary heap,
+    // recording the origin and cost of every node in `ws`
+    void dijkstra(Node src, TraversalWorkspace& ws, Node target = -1) {
+        ws.begin(size());
+        ws.reach(src, src, 0);
+        ws.overflowed.clear();
+
+        // Min-heap on top of the workspace buffer, to keep its capacity
+        auto& heap = ws.heap;
+        auto greater = std::greater<std::pair<int, Node>>();
+        heap.assign(1, {0, src});
+
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), greater);
+            auto [cost, current] = heap.back();
+            heap.pop_back();
+
+            // Stale entry, the node was pushed again with a lower cost
+            if (cost > ws.distance(current)) continue;
+            if (current == target) return;
+
+            relax_edges(current, ws, [&](Node next, int new_cost) {
+                heap.emplace_back(new_cost, next);
+                std::push_heap(heap.begin(), heap.end(), greater);
+            });
+        }
+
+        check_costs(ws);
+    }
 
-        std::vector<Node> came_from(size(), -1);
-        std::vector<Node> cost_so_far(size(), -1);
+    // Serial implementation of the Dijkstra algorithm with a radix heap.
+    //
+    // Since Dijkstra pops costs in increasing order and weights are integers,
+    // a radix heap replaces the O(log n) heap operations with amortized
+    // O(log C) bucket moves, C being the largest cost. Same contract as
+    // `dijkstra`.
+    std::pair<std::vector<Node>, std::vector<Node>> radix_dijkstra(Node src, Node target = -1) {
+        TraversalWorkspace ws;
+        radix_dijkstra(src, ws, target);
+
+        return std::make_pair(ws.parent_array(size()), ws.distance_array(size()));
+    }
 
-        came_from[src] = src;
-        cost_so_far[src] = 0;
+    // Serial implementation of the Dijkstra algorithm with a radix heap,
+    // recording the origin and cost of every node in `ws`
+    void radix_dijkstra(Node src, TraversalWorkspace& ws, Node target = -1) {
+        ws.begin(size());
+        ws.reach(src, src, 0);
+        ws.overflowed.clear();
 
-        auto node_locks = initialize_locks();
+        auto& queue = ws.radix_heap;
+        queue.clear();
+        queue.push(0, src);
 
         while (!queue.empty()) {
-            Node current = queue.back();
-            queue.pop_back();
+            auto [cost, current] = queue.pop();
 
-#pragma omp parallel shared(queue, node_locks)
-#pragma omp for
-            for (int next = 0; next < n_nodes(); next++) {
-                if (edge_exists(current, next)) {
-                    omp_set_lock(&node_locks[current]);
-                    auto cost_so_far_current = cost_so_far[current];
-                    omp_unset_lock(&node_locks[current]);
+            if (int(cost) > ws.distance(current)) continue;
+            if (current == target) return;
 
-                    int new_cost = cost_so_far_current + adj_matrix[current][next];
+            relax_edges(current, ws, [&](Node next, int new_cost) { queue.push(new_cost, next); });
+        }
 
-                    omp_set_lock(&node_locks[next]);
-                    auto cost_so_far_next = cost_so_far[next];
-                    omp_unset_lock(&node_locks[next]);
+        check_costs(ws);
+    }
 
-                    if (cost_so_far_next == -1 || new_cost < cost_so_far_next) {
-                        omp_set_lock(&node_locks[next]);
-                        cost_so_far[next] = new_cost;
-                        came_from[next] = current;
-                        omp_unset_lock(&node_locks[next]);
+    // Parallel implementation of single source shortest paths with
+    // delta-stepping (Meyer and Sanders).
+    //
+    // Nodes are kept in buckets of width `delta` by tentative cost. The
+    // lowest bucket is settled by relaxing its light edges (weight <= delta)
+    // in parallel until it stops refilling, then the heavy edges of every node
+    // it settled are relaxed once. The cost and origin of each node are packed
+    // in a single 64-bit word updated with compare and swap, so the two always
+    // agree without any lock.
+    //
+    // `delta` defaults to the largest weight over the average degree. Same
+    // result shape as `dijkstra`.
+    std::pair<std::vector<Node>, std::vector<Node>> p_dijkstra(Node src, int delta = 0) {
+        TraversalWorkspace ws;
+        p_dijkstra(src, ws, delta);
 
-#pragma omp critical(queue_update)
-                        queue.push_back(next);
-                    }
-                }
+        return std::make_pair(ws.parent_array(size()), ws.distance_array(size()));
+    }
+
+    // Parallel delta-stepping, recording the origin and cost of every node in
+    // `ws`
+    void p_dijkstra(Node src, TraversalWorkspace& ws, int delta = 0) {
+        if (delta <= 0) delta = default_delta();
+
+        ws.begin(size());
+
+        auto& best = ws.best;
+        if (int(best.size()) < size()) {
+            best = std::vector<std::atomic<std::uint64_t>>(size());
+
+#pragma omp parallel for
+            for (int node = 0; node < n_nodes(); node++) best[node].store(unreached);
+        }
+
+        best[src].store(pack_cost(0, src));
+        ws.overflowed.clear();
+
+        auto& buckets = ws.buckets;
+        for (auto& bucket : buckets) bucket.clear();
+        if (buckets.empty()) buckets.resize(1);
+        buckets[0].push_back(src);
+
+        auto& frontier = ws.frontier;
+        auto& settled = ws.next_frontier;
+
+        // Every node reached, to export and reset them at the end
+        auto& reached = ws.queue;
+        reached.clear();
+
+        for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+            settled.clear();
+
+            // Light edges may put nodes back in the current bucket
+            while (!buckets[bucket].empty()) {
+                frontier.swap(buckets[bucket]);
+                buckets[bucket].clear();
+
+                delta_relax(src, frontier, bucket, delta, best, buckets, ws.overflowed, true);
+                settled.insert(settled.end(), frontier.begin(), frontier.end());
+            }
+
+            delta_relax(src, settled, bucket, delta, best, buckets, ws.overflowed, false);
+            reached.insert(reached.end(), settled.begin(), settled.end());
+        }
+
+#pragma omp parallel for
+        for (size_t i = 0; i < reached.size(); i++) {
+            Node node = reached[i];
+
+            // A node may have been settled more than once
+            if (ws.claim(node)) {
+                std::uint64_t packed = best[node].load(std::memory_order_relaxed);
+                ws.set(node, Node(packed & 0xffffffff), packed >> 32);
             }
         }
 
-        // Destory locks
-        for (int node = 0; node < n_nodes(); node++) omp_destroy_lock(&(node_locks[node]));
+#pragma omp parallel for
+        for (size_t i = 0; i < reached.size(); i++)
+            best[reached[i]].store(unreached, std::memory_order_relaxed);
 
-        return std::make_pair(came_from, cost_so_far);
+        check_costs(ws);
     }
 
     // Reconstruct path from the destination to the source
-    std::vector<Node> reconstruct_path(Node src, Node dst, std::vector<Node> origins) {
+    std::vector<Node> reconstruct_path(Node src, Node dst, const std::vector<Node>& origins) {
         auto current_node = dst;
         std::vector<Node> path;
 
@@ -327,49 +950,562 @@ struct Graph {
         return path;
     }
 
+    // Reconstruct path from the destination to the source, from the parents
+    // recorded in a workspace
+    std::vector<Node> reconstruct_path(Node src, Node dst, const TraversalWorkspace& ws) {
+        if (!ws.reached(dst)) {
+            throw std::out_of_range("Destination was not reached by the traversal.");
+        }
+
+        std::vector<Node> path{dst};
+        for (Node node = dst; node != src; node = ws.parent(node)) path.push_back(ws.parent(node));
+
+        reverse(path.begin(), path.end());
+
+        return path;
+    }
+
    private:
-    // Return true if a node is already visited using a node level lock
-    inline bool atomic_test_visited(Node node, const std::vector<int>& visited, omp_lock_t* lock) {
-        omp_set_lock(lock);
-        bool already_visited = visited.at(node);
-        omp_unset_lock(lock);
+    // CSR arrays owned by a graph built in memory
+    struct CsrBuffers {
+        std::vector<Offset> offsets;
+        std::vector<Node> targets;
+        std::vector<int> weights;
+    };
+
+    // Expand every node of the frontier, claiming its unvisited neighbors.
+    //
+    // Returns the number of edges leaving the new frontier.
+    Offset bfs_top_down_step(int level, const std::vector<Node>& frontier,
+                             std::vector<Node>& next_frontier, TraversalWorkspace& ws) {
+        Offset frontier_edges = 0;
+
+#pragma omp parallel reduction(+ : frontier_edges)
+        {
+            std::vector<Node> private_queue;
+
+#pragma omp for nowait schedule(dynamic, 64)
+            for (size_t i = 0; i < frontier.size(); i++) {
+                Node node = frontier[i];
+
+                for (Node next : neighbors(node)) {
+                    if (ws.claim(next)) {
+                        ws.set(next, node, level);
+                        private_queue.push_back(next);
+                        frontier_edges += degree(next);
+                    }
+                }
+            }
+
+#pragma omp critical(queue_update)
+            next_frontier.insert(next_frontier.end(), private_queue.begin(), private_queue.end());
+        }
+
+        return frontier_edges;
+    }
+
+    // Let every unvisited node look for a parent in the frontier. Each node is
+    // only written by the thread checking it, so no atomics are needed.
+    //
+    // Returns the number of edges leaving the new frontier.
+    Offset bfs_bottom_up_step(int level, const std::vector<char>& in_frontier,
+                              std::vector<char>& in_next_frontier,
+                              std::vector<Node>& next_frontier, TraversalWorkspace& ws) {
+        Offset frontier_edges = 0;
+        in_next_frontier.assign(size(), false);
+
+#pragma omp parallel reduction(+ : frontier_edges)
+        {
+            std::vector<Node> private_queue;
+
+#pragma omp for nowait schedule(dynamic, 1024)
+            for (Node node = 0; node < size(); node++) {
+                if (ws.reached(node)) continue;
+
+                for (Node prev : neighbors(node)) {
+                    if (in_frontier[prev]) {
+                        ws.reach(node, prev, level);
+                        in_next_frontier[node] = true;
+                        private_queue.push_back(node);
+                        frontier_edges += degree(node);
+                        break;
+                    }
+                }
+            }
+
+#pragma omp critical(queue_update)
+            next_frontier.insert(next_frontier.end(), private_queue.begin(), private_queue.end());
+        }
 
-        return already_visited;
+        return frontier_edges;
     }
 
-    // Set that a node is already visited using a node level lock
-    inline void atomic_set_visited(Node node, std::vector<int>& visited, omp_lock_t* lock) {
-        omp_set_lock(lock);
-        visited[node] = true;
-        omp_unset_lock(lock);
+    // Convert a frontier from a list of nodes to a dense bitmap
+    void frontier_to_bitmap(const std::vector<Node>& frontier, std::vector<char>& bitmap) {
+        bitmap.assign(size(), false);
+
+#pragma omp parallel for
+        for (size_t i = 0; i < frontier.size(); i++) bitmap[frontier[i]] = true;
+    }
+
+    // Sort every adjacency list by target, keeping weights aligned
+    static void sort_adjacency(CsrBuffers& csr) {
+        auto& offsets = csr.offsets;
+        auto& targets = csr.targets;
+        auto& weights = csr.weights;
+        int n = offsets.size() - 1;
+
+#pragma omp parallel for schedule(dynamic, 1024)
+        for (int node = 0; node < n; node++) {
+            Offset first = offsets[node], last = offsets[node + 1];
+            if (std::is_sorted(targets.begin() + first, targets.begin() + last)) continue;
+
+            std::vector<std::pair<Node, int>> row;
+            row.reserve(last - first);
+            for (Offset i = first; i < last; i++) row.emplace_back(targets[i], weights[i]);
+
+            std::sort(row.begin(), row.end());
+            for (Offset i = first; i < last; i++) std::tie(targets[i], weights[i]) = row[i - first];
+        }
+    }
+
+    // Relax the edges leaving `current`, calling `push(next, new_cost)` for
+    // every node whose cost improves
+    template <typename Push>
+    void relax_edges(Node current, TraversalWorkspace& ws, Push push) {
+        auto adj = neighbors(current);
+        auto adj_weights = edge_weights(current);
+        int cost = ws.distance(current);
+
+        for (Offset i = 0; i < adj.size(); i++) {
+            Node next = adj[i];
+            std::int64_t new_cost = std::int64_t(cost) + adj_weights[i];
+
+            if (new_cost > INT_MAX) {
+                if (!ws.reached(next)) ws.overflowed.push_back(next);
+                continue;
+            }
+
+            if (!ws.reached(next) || new_cost < ws.distance(next)) {
+                ws.reach(next, current, int(new_cost));
+                push(next, int(new_cost));
+            }
+        }
+    }
+
+    // Costs are ints, and relaxations that would go past INT_MAX are dropped.
+    // That is harmless for a node reached along some other path, whose cost
+    // is lower anyway, but a node only reachable past INT_MAX would silently
+    // read as unreached, so that is reported instead.
+    void check_costs(const TraversalWorkspace& ws) const {
+        for (Node node : ws.overflowed) {
+            if (!ws.reached(node)) {
+                throw std::overflow_error("Shortest path cost does not fit in an int.");
+            }
+        }
+    }
+
+    // Packed (cost, origin) of a node that has not been reached yet
+    static constexpr std::uint64_t unreached = ~std::uint64_t(0);
+
+    // Pack the cost of a node in the high half and its origin in the low half.
+    // Only the cost half decides which of two values is better, see
+    // `delta_relax`
+    static std::uint64_t pack_cost(int cost, Node origin) {
+        return (std::uint64_t(cost) << 32) | std::uint32_t(origin);
+    }
+
+    // Delta used by `p_dijkstra` when none is given: the largest weight over
+    // the average degree, at least 1
+    int default_delta() {
+        int max_weight = 1;
+
+#pragma omp parallel for reduction(max : max_weight)
+        for (Offset i = 0; i < n_edges(); i++) max_weight = std::max(max_weight, weights[i]);
+
+        Offset average_degree = std::max<Offset>(1, n_edges() / std::max(1, n_nodes()));
+        return std::max<Offset>(1, max_weight / average_degree);
+    }
+
+    // Relax in parallel either the light or the heavy edges of the nodes of
+    // `bucket`, adding improved nodes to the buckets of their new cost.
+    //
+    // A relaxation only wins with a strictly lower cost. Comparing whole
+    // packed values would also let an equal cost from a lower origin id win,
+    // which with zero-weight edges re-parents settled nodes, the source
+    // included, into cycles.
+    void delta_relax(Node src, const std::vector<Node>& nodes, size_t bucket, int delta,
+                     std::vector<std::atomic<std::uint64_t>>& best,
+                     std::vector<std::vector<Node>>& buckets, std::vector<Node>& overflowed,
+                     bool light) {
+#pragma omp parallel shared(buckets, overflowed)
+        {
+            std::vector<std::vector<Node>> private_buckets;
+            std::vector<Node> private_overflowed;
+
+#pragma omp for nowait schedule(dynamic, 64)
+            for (size_t i = 0; i < nodes.size(); i++) {
+                Node current = nodes[i];
+                int cost = best[current].load(std::memory_order_relaxed) >> 32;
+
+                // Stale entry, the node has since moved to a lower bucket
+                if (size_t(cost / delta) != bucket) continue;
+
+                auto adj = neighbors(current);
+                auto adj_weights = edge_weights(current);
+
+                for (Offset e = 0; e < adj.size(); e++) {
+                    if ((adj_weights[e] <= delta) != light || adj[e] == src) continue;
+
+                    std::int64_t new_cost = std::int64_t(cost) + adj_weights[e];
+                    if (new_cost > INT_MAX) {
+                        private_overflowed.push_back(adj[e]);
+                        continue;
+                    }
+
+                    std::uint64_t packed = pack_cost(int(new_cost), current);
+                    std::uint64_t old = best[adj[e]].load(std::memory_order_relaxed);
+
+                    while ((packed >> 32) < (old >> 32) &&
+                           !best[adj[e]].compare_exchange_weak(old, packed)) {
+                    }
+
+                    if ((packed >> 32) < (old >> 32)) {
+                        size_t target = new_cost / delta;
+                        if (target >= private_buckets.size()) private_buckets.resize(target + 1);
+                        private_buckets[target].push_back(adj[e]);
+                    }
+                }
+            }
+
+#pragma omp critical(bucket_update)
+            {
+                if (private_buckets.size() > buckets.size()) buckets.resize(private_buckets.size());
+
+                for (size_t b = bucket; b < private_buckets.size(); b++)
+                    buckets[b].insert(buckets[b].end(), private_buckets[b].begin(),
+                                      private_buckets[b].end());
+
+                overflowed.insert(overflowed.end(), private_overflowed.begin(),
+                                  private_overflowed.end());
+            }
+        }
     }
+
+    // Nodes a thread of `p_rdfs` exposes to the other threads. The owner
+    // takes from the back, thieves take from the front, both under the lock;
+    // the lock is only touched when a private stack overflows or runs dry.
+    struct alignas(64) WorkDeque {
+        omp_lock_t lock;
+        std::deque<Node> nodes;
+        std::atomic<size_t> count{0};
+
+        WorkDeque() { omp_init_lock(&lock); }
+        ~WorkDeque() { omp_destroy_lock(&lock); }
+
+        bool empty() const { return count.load(std::memory_order_relaxed) == 0; }
+
+        // Add a single node at the back of the deque
+        void push(Node node) {
+            omp_set_lock(&lock);
+            nodes.push_back(node);
+            count = nodes.size();
+            omp_unset_lock(&lock);
+        }
+
+        // Move the oldest half of `stack` to the back of the deque
+        void share(std::vector<Node>& stack) {
+            size_t half = stack.size() / 2;
+
+            omp_set_lock(&lock);
+            nodes.insert(nodes.end(), stack.begin(), stack.begin() + half);
+            count = nodes.size();
+            omp_unset_lock(&lock);
+
+            stack.erase(stack.begin(), stack.begin() + half);
+        }
+
+        // Owner side: move the newest node to `stack`
+        bool pop(std::vector<Node>& stack) {
+            if (empty()) return false;
+
+            omp_set_lock(&lock);
+            bool found = !nodes.empty();
+            if (found) {
+                stack.push_back(nodes.back());
+                nodes.pop_back();
+                count = nodes.size();
+            }
+            omp_unset_lock(&lock);
+
+            return found;
+        }
+
+        // Thief side: move the oldest half of the deque (at least one node)
+        // to `stack`
+        bool steal(std::vector<Node>& stack) {
+            if (empty()) return false;
+
+            omp_set_lock(&lock);
+            size_t taken = (nodes.size() + 1) / 2;
+            stack.insert(stack.end(), nodes.begin(), nodes.begin() + taken);
+            nodes.erase(nodes.begin(), nodes.begin() + taken);
+            count = nodes.size();
+            omp_unset_lock(&lock);
+
+            return taken > 0;
+        }
+    };
+
 };
 
-// Import graph from a file
-Graph import_graph(std::string& path) {
-    Graph graph;
+// Minimal integer scanner over an in-memory text buffer.
+//
+// Much faster than `std::stringstream`, since it neither allocates nor goes
+// through locales: it skips whitespace, then accumulates the digits of an
+// optionally signed integer. Anything else, like `1a2` or `3,4`, is rejected
+// rather than skipped, so junk input fails instead of reading as a graph.
+struct IntScanner {
+    const char* cur;
+    const char* end;
+
+    static bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+    // Read the next integer, returns false at the end of the buffer
+    bool next(long long& value) {
+        while (cur < end && is_space(*cur)) cur++;
+        if (cur == end) return false;
 
-    std::ifstream file(path);
+        bool negative = *cur == '-';
+        if (negative || *cur == '+') cur++;
+
+        if (cur == end || !is_digit(*cur))
+            throw std::invalid_argument("Malformed integer in input file.");
+
+        long long result = 0;
+        while (cur < end && is_digit(*cur)) {
+            if (result > (LLONG_MAX - 9) / 10)
+                throw std::invalid_argument("Integer out of range in input file.");
+            result = result * 10 + (*cur++ - '0');
+        }
+
+        if (cur < end && !is_space(*cur))
+            throw std::invalid_argument("Malformed integer in input file.");
+
+        value = negative ? -result : result;
+        return true;
+    }
+};
+
+// Import graph from an edge list file.
+//
+// The file starts with a `V E` header followed by E `src dst weight` triples.
+// Unless `directed` is set, every edge is inserted in both directions.
+inline Graph import_graph(const std::string& path, bool directed = false) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
     if (!file.is_open()) {
         throw std::invalid_argument("Input file does not exist or is not readable.");
     }
 
-    std::string line;
+    // Load the whole file at once, parsing from memory is much faster than
+    // reading it one line at a time
+    std::vector<char> buffer(file.tellg());
+    file.seekg(0);
+    file.read(buffer.data(), buffer.size());
+
+    IntScanner scanner{buffer.data(), buffer.data() + buffer.size()};
+
+    long long n_nodes, n_edges;
+    if (!scanner.next(n_nodes) || !scanner.next(n_edges) || n_nodes < 0 || n_edges < 0) {
+        throw std::invalid_argument("Input file is missing the `V E` header.");
+    }
+
+    if (n_nodes > INT_MAX) {
+        throw std::invalid_argument("Input file has more nodes than fit in a node id.");
+    }
+
+    // The header tells how many edges follow, so storage is sized once. Every
+    // edge takes at least six bytes of text, which bounds the reservation when
+    // the header overstates E
+    long long max_edges = std::min<long long>(n_edges, buffer.size() / 6);
+    std::vector<Graph::Edge> edges;
+    edges.reserve(directed ? max_edges : 2 * max_edges);
+
+    for (long long i = 0; i < n_edges; i++) {
+        long long src, dst, weight;
+        if (!scanner.next(src) || !scanner.next(dst) || !scanner.next(weight)) {
+            throw std::invalid_argument("Input file has fewer edges than its header declares.");
+        }
 
-    // Read one line at a time into the variable line
-    while (getline(file, line)) {
-        std::vector<int> lineData;
-        std::stringstream lineStream(line);
+        if (src < 0 || src >= n_nodes || dst < 0 || dst >= n_nodes) {
+            throw std::invalid_argument("Input file has an edge to a node out of range.");
+        }
 
-        // Read an integer at a time from the line
-        int value;
-        while (lineStream >> value) lineData.push_back(value);
+        // Every shortest path kernel assumes non-negative weights
+        if (weight < 0 || weight > INT_MAX) {
+            throw std::invalid_argument("Input file has an edge weight out of range.");
+        }
 
-        lineData.shrink_to_fit();  // Usefull?
-        graph.adj_matrix.push_back(lineData);
+        edges.push_back({Graph::Node(src), Graph::Node(dst), int(weight)});
+        if (!directed) edges.push_back({Graph::Node(dst), Graph::Node(src), int(weight)});
     }
 
-    graph.adj_matrix.shrink_to_fit();
+    return Graph::from_edges(n_nodes, edges, directed);
+}
+
+// Binary graph format, written by `save_graph` and read by `mmap_graph`.
+//
+// The file is the header below followed by the raw CSR arrays, in native byte
+// order: (V + 1) offsets, E targets and E weights. Every array starts at an
+// offset aligned to its element size, so the mapped file is used as is.
+struct BinaryGraphHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::int64_t n_nodes;
+    std::int64_t n_edges;
+};
+
+static_assert(sizeof(BinaryGraphHeader) == 32, "CSR arrays must stay 8-byte aligned");
+
+constexpr char binary_graph_magic[8] = {'C', 'S', 'R', 'G', 'R', 'A', 'P', 'H'};
+constexpr std::uint32_t binary_graph_version = 1;
+
+// Set in the header flags when the graph is directed
+constexpr std::uint32_t binary_graph_directed = 1;
+
+// Returns if the file starts with the binary graph magic
+inline bool is_binary_graph(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(binary_graph_magic)] = {};
+    file.read(magic, sizeof(magic));
+
+    return file && std::memcmp(magic, binary_graph_magic, sizeof(magic)) == 0;
+}
+
+// Write a graph to a file in the binary graph format
+inline void save_graph(const Graph& graph, const std::string& path) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::invalid_argument("Output file is not writable.");
+    }
+
+    BinaryGraphHeader header{};
+    std::memcpy(header.magic, binary_graph_magic, sizeof(header.magic));
+    header.version = binary_graph_version;
+    header.flags = graph.directed ? binary_graph_directed : 0;
+    header.n_nodes = graph.n_nodes();
+    header.n_edges = graph.n_edges();
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(graph.offsets),
+               sizeof(Graph::Offset) * (graph.n_nodes() + 1));
+    file.write(reinterpret_cast<const char*>(graph.targets), sizeof(Graph::Node) * graph.n_edges());
+    file.write(reinterpret_cast<const char*>(graph.weights), sizeof(int) * graph.n_edges());
+
+    if (!file) {
+        throw std::runtime_error("Failed to write the binary graph file.");
+    }
+}
+
+// Map a binary graph file into memory.
+//
+// Nothing is parsed or copied: the CSR arrays of the returned graph point into
+// the mapping, and the mapping is released with the last copy of the graph.
+// The arrays are checked once, in parallel, so that a truncated or foreign
+// file fails here rather than sending a traversal out of bounds.
+inline Graph mmap_graph(const std::string& path) {
+    // Owns a read-only mapping of a whole file
+    struct MappedFile {
+        void* addr = MAP_FAILED;
+        size_t length = 0;
+
+        ~MappedFile() {
+            if (addr != MAP_FAILED) munmap(addr, length);
+        }
+    };
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::invalid_argument("Input file does not exist or is not readable.");
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(BinaryGraphHeader)) {
+        close(fd);
+        throw std::invalid_argument("Input file is not a binary graph.");
+    }
+
+    auto mapping = std::make_shared<MappedFile>();
+    mapping->length = info.st_size;
+    mapping->addr = mmap(nullptr, mapping->length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping->addr == MAP_FAILED) {
+        throw std::runtime_error("Failed to map the binary graph file.");
+    }
+
+    const char* data = static_cast<const char*>(mapping->addr);
+    BinaryGraphHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, binary_graph_magic, sizeof(header.magic)) != 0 ||
+        header.version != binary_graph_version) {
+        throw std::invalid_argument("Input file is not a binary graph.");
+    }
+
+    // Counts are bounded by the file size before any byte size is computed,
+    // so a corrupted header cannot overflow them
+    size_t payload = mapping->length - sizeof(header);
+    if (header.n_nodes < 0 || header.n_nodes > INT_MAX || header.n_edges < 0 ||
+        std::uint64_t(header.n_edges) > payload / (sizeof(Graph::Node) + sizeof(int))) {
+        throw std::invalid_argument("Binary graph file is truncated or corrupted.");
+    }
+
+    size_t offsets_bytes = sizeof(Graph::Offset) * (header.n_nodes + 1);
+    size_t targets_bytes = sizeof(Graph::Node) * header.n_edges;
+    size_t weights_bytes = sizeof(int) * header.n_edges;
+
+    if (mapping->length != sizeof(header) + offsets_bytes + targets_bytes + weights_bytes) {
+        throw std::invalid_argument("Binary graph file is truncated or corrupted.");
+    }
+
+    // Offsets start at 0, never decrease and end at E, targets are nodes and
+    // weights are non-negative like those import_graph accepts
+    const std::int64_t n = header.n_nodes, m = header.n_edges;
+    const auto* offsets = reinterpret_cast<const Graph::Offset*>(data + sizeof(header));
+    const auto* targets = reinterpret_cast<const Graph::Node*>(data + sizeof(header) + offsets_bytes);
+    const int* weights = reinterpret_cast<const int*>(data + sizeof(header) + offsets_bytes + targets_bytes);
+    bool invalid = offsets[0] != 0 || offsets[n] != m;
+
+#pragma omp parallel for reduction(|| : invalid)
+    for (std::int64_t v = 0; v < n; v++) invalid = invalid || offsets[v] > offsets[v + 1];
+
+#pragma omp parallel for reduction(|| : invalid)
+    for (std::int64_t e = 0; e < m; e++)
+        invalid = invalid || targets[e] < 0 || targets[e] >= n || weights[e] < 0;
+
+    if (invalid) {
+        throw std::invalid_argument("Binary graph file is truncated or corrupted.");
+    }
+
+    Graph graph;
+    graph.offsets = offsets;
+    graph.targets = targets;
+    graph.weights = weights;
+    graph.node_count = header.n_nodes;
+    graph.edge_count = header.n_edges;
+    graph.directed = header.flags & binary_graph_directed;
+    graph.storage = std::move(mapping);
 
     return graph;
 }
+
+// Load a graph from either a binary graph file or an edge list file
+inline Graph load_graph(const std::string& path) {
+    return is_binary_graph(path) ? mmap_graph(path) : import_graph(path);
+}
@@ -1,122 +1,53 @@
 // To compile:
-// g++ -std=c++17 -fopenmp Bubble+merge.cpp -o combined_sorts
+// g++ -std=c++17 -O2 -march=native -fopenmp Bubble+merge.cpp -o combined_sorts
 // To run:
-// ./combined_sorts <array_length> <max_random_value>
+// ./combined_sorts <array_length> <max_random_value> [--samples=N] [--threads=1,2,4] [--format=text|csv|json]
 
 #include <omp.h>
 #include <cstdlib>
-#include <chrono>
-#include <functional>
 #include <iostream>
 #include <algorithm>
 #include <string>
+#include <vector>
+
+#include "../common/bench.hpp"
+#include "sort.hpp"
 
 using namespace std;
 
-// Sequential Merge Sort declarations
-void s_mergesort(int *a, int i, int j);
-// Parallel Merge Sort declarations
-void p_mergesort(int *a, int i, int j);
-void parallel_mergesort(int *a, int i, int j);
-void merge_ranges(int *a, int i1, int j1, int i2, int j2);
-
-// Bubble Sort declarations
-void s_bubble(int *a, int n);
-void p_bubble(int *a, int n);
-void swap_vals(int &a, int &b);
-
-// Benchmark helper
-string bench_traverse(function<void()> fn) {
-    auto start = chrono::high_resolution_clock::now();
-    fn();
-    auto stop = chrono::high_resolution_clock::now();
-    auto dur = chrono::duration_cast<chrono::milliseconds>(stop - start);
-    return to_string(dur.count());
-}
+// The int entry points below take inclusive bounds [i, j] and forward to the
+// generic sorts in sort.hpp, which pick the SIMD kernels for int arrays
 
-// Sequential merge sort
 void s_mergesort(int *a, int i, int j) {
-    if (i < j) {
-        int mid = (i + j) / 2;
-        s_mergesort(a, i, mid);
-        s_mergesort(a, mid + 1, j);
-        merge_ranges(a, i, mid, mid + 1, j);
-    }
-}
-
-// Parallel merge sort task
-void p_mergesort(int *a, int i, int j) {
-    if (i < j) {
-        int mid = (i + j) / 2;
-        if ((j - i) > 1000) {
-            #pragma omp task firstprivate(a, i, mid)
-            p_mergesort(a, i, mid);
-            #pragma omp task firstprivate(a, mid, j)
-            p_mergesort(a, mid + 1, j);
-            #pragma omp taskwait
-            merge_ranges(a, i, mid, mid + 1, j);
-        } else {
-            s_mergesort(a, i, j);
-        }
-    }
+    merge_sort(a + i, a + j + 1);
 }
 
 void parallel_mergesort(int *a, int i, int j) {
-    #pragma omp parallel
-    {
-        #pragma omp single
-        p_mergesort(a, i, j);
-    }
+    p_merge_sort(a + i, a + j + 1);
 }
 
-// Merge two sorted subarrays
-void merge_ranges(int *a, int i1, int j1, int i2, int j2) {
-    int size = j2 - i1 + 1;
-    int *temp = new int[size];
-    int i = i1, j = i2, k = 0;
-    while (i <= j1 && j <= j2) {
-        temp[k++] = (a[i] < a[j]) ? a[i++] : a[j++];
-    }
-    while (i <= j1) temp[k++] = a[i++];
-    while (j <= j2) temp[k++] = a[j++];
-    for (i = i1, k = 0; i <= j2; ++i, ++k) {
-        a[i] = temp[k];
-    }
-    delete[] temp;
+void parallel_samplesort(int *a, int i, int j) {
+    p_sample_sort(a + i, a + j + 1);
 }
 
 // Sequential bubble sort
 void s_bubble(int *a, int n) {
-    for (int i = 0; i < n; i++) {
-        int first = i % 2;
-        for (int j = first; j < n - 1; j += 2) {
-            if (a[j] > a[j + 1]) swap_vals(a[j], a[j + 1]);
-        }
-    }
+    bubble_sort(a, a + n);
 }
 
 // Parallel bubble sort
 void p_bubble(int *a, int n) {
-    for (int i = 0; i < n; i++) {
-        int first = i % 2;
-        #pragma omp parallel for shared(a, first)
-        for (int j = first; j < n - 1; j += 2) {
-            if (a[j] > a[j + 1]) swap_vals(a[j], a[j + 1]);
-        }
-    }
-}
-
-void swap_vals(int &a, int &b) {
-    int tmp = a;
-    a = b;
-    b = tmp;
+    p_bubble_sort(a, a + n);
 }
 
 int main(int argc, char **argv) {
+    Bench bench(BenchOptions::from_args(argc, argv));
+    const auto &args = bench.config().args;
+
     int n, rand_max;
-    if (argc >= 3) {
-        n = stoi(argv[1]);
-        rand_max = stoi(argv[2]);
+    if (args.size() >= 2) {
+        n = stoi(args[0]);
+        rand_max = stoi(args[1]);
     } else {
         cout << "Enter array length: ";
         cin >> n;
@@ -126,48 +57,44 @@ int main(int argc, char **argv) {
 
     // Allocate arrays
     int *orig = new int[n];
-    int *mseq = new int[n];
-    int *mpar = new int[n];
-    int *bseq = new int[n];
-    int *bpar = new int[n];
+    int *work = new int[n];
 
     // Generate random data
     for (int i = 0; i < n; i++) orig[i] = rand() % rand_max;
-    copy(orig, orig + n, mseq);
-    copy(orig, orig + n, mpar);
-    copy(orig, orig + n, bseq);
-    copy(orig, orig + n, bpar);
-
-    cout << "Generated array of length " << n << " with max value " << rand_max << "\n\n";
-
-    // Sequential Merge Sort
-    cout << "Sequential Merge Sort: "
-         << bench_traverse([&](){ s_mergesort(mseq, 0, n-1); })
-         << " ms\n";
-
-    // Parallel Merge Sort
-    omp_set_num_threads(16);
-    cout << "Parallel Merge Sort (16 threads): "
-         << bench_traverse([&](){ parallel_mergesort(mpar, 0, n-1); })
-         << " ms\n\n";
-
-    // Sequential Bubble Sort
-    cout << "Sequential Bubble Sort: "
-         << bench_traverse([&](){ s_bubble(bseq, n); })
-         << " ms\n";
-
-    // Parallel Bubble Sort
-    omp_set_num_threads(16);
-    cout << "Parallel Bubble Sort (16 threads): "
-         << bench_traverse([&](){ p_bubble(bpar, n); })
-         << " ms\n";
+
+    // Every run sorts a fresh copy of the input, restored outside of the timing
+    auto reset = [&]() { copy(orig, orig + n, work); };
+
+    bench.note("Generated array of length " + to_string(n) + " with max value " + to_string(rand_max) + "\n");
+
+    // Merge Sort
+    bench.run("Sequential Merge Sort", [&]() { s_mergesort(work, 0, n - 1); }, reset);
+    bench.sweep("Parallel Merge Sort", [&]() { parallel_mergesort(work, 0, n - 1); }, reset);
+
+    // Sample Sort
+    bench.sweep("Parallel Sample Sort", [&]() { parallel_samplesort(work, 0, n - 1); }, reset);
+    // Frequent keys get equality buckets, so no bucket to sort should hold
+    // much more than its share of the input even with few distinct values
+    vector<ptrdiff_t> buckets = sample_sort_buckets(orig, orig + n);
+    if (buckets.size() > 1) {
+        ptrdiff_t largest = 0;
+        for (size_t b = 0; b < buckets.size(); b += 2) largest = max(largest, buckets[b]);
+        bench.note("Sample sort: " + to_string(buckets.size()) + " buckets on " + to_string(omp_get_max_threads()) +
+                   " threads, the largest one to sort holds " + to_string(100.0 * double(largest) / n) +
+                   "% of the input");
+    }
+
+    // Radix Sort
+    bench.run("Sequential Radix Sort", [&]() { s_radix_sort(work, n); }, reset);
+    bench.sweep("Parallel Radix Sort", [&]() { p_radix_sort(work, n); }, reset);
+
+    // Bubble Sort
+    bench.run("Sequential Bubble Sort", [&]() { s_bubble(work, n); }, reset);
+    bench.sweep("Parallel Bubble Sort", [&]() { p_bubble(work, n); }, reset);
 
     // Clean up
     delete[] orig;
-    delete[] mseq;
-    delete[] mpar;
-    delete[] bseq;
-    delete[] bpar;
+    delete[] work;
 
     return 0;
 }
@@ -1,19 +1,16 @@
 //to run code
-//g++ -fopenmp bubble_sort.cpp -o bubble_sort
-//./bubble_sort 50 20
+//g++ -std=c++17 -O2 -fopenmp bubble.cpp -o bubble_sort
+//./bubble_sort 50 20 [--samples=N] [--threads=1,2,4] [--format=text|csv|json]
 
 #include <omp.h>
 #include <stdlib.h>
-#include <chrono>
-#include <array>
-#include <functional>
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector> 
 
-auto start = std::chrono::high_resolution_clock::now();
-auto stop = std::chrono::high_resolution_clock::now();
-auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
+#include "../common/bench.hpp"
+#include "sort.hpp"
 
 using namespace std;
 
@@ -34,19 +31,10 @@ void s_bubble(int *a, int n) {
     }
 }
 
+// Block odd-even transposition sort with early exit, shared with the
+// combined benchmark through sort.hpp
 void p_bubble(int *a, int n) {
-    for (int i = 0; i < n; i++) 
-    {
-        int first = i % 2;
-        #pragma omp parallel for shared(a, first) num_threads(16)
-        for (int j = first; j < n - 1; j += 2) 
-        {
-            if (a[j] > a[j + 1]) 
-            {
-                swap(a[j], a[j + 1]);
-            }
-        }
-    }
+    p_bubble_sort(a, a + n);
 }
 
 void swap(int &a, int &b) {
@@ -57,30 +45,14 @@ void swap(int &a, int &b) {
 }
 
 
-std::string bench_traverse(std::function<void()> traverse_fn) {
-    auto start = std::chrono::high_resolution_clock::now();
-    traverse_fn();
-    auto stop = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
-    return std::to_string(duration.count());
-}
-
-#include <iostream>
-#include <cstdlib>
-#include <algorithm> // For std::copy
-#include <omp.h>     // For OpenMP functions
-#include <string>    // For std::stoi
-
-using namespace std;
-
-// Assuming the bubble sort functions s_bubble and p_bubble are defined elsewhere
-
 int main(int argc, const char **argv) {
+    Bench bench(BenchOptions::from_args(argc, argv));
+    const auto &args = bench.config().args;
 
     int n, rand_max;
 
     // Check if command-line arguments are provided
-    if (argc < 3) {
+    if (args.size() < 2) {
         std::cout << "Specify array length and maximum random value\n";
 
         // Prompt user for input if arguments are not provided
@@ -91,8 +63,8 @@ int main(int argc, const char **argv) {
         std::cin >> rand_max;
     } else {
         // Parse array length and maximum random value from arguments
-        n = stoi(argv[1]);
-        rand_max = stoi(argv[2]);
+        n = stoi(args[0]);
+        rand_max = stoi(args[1]);
     }
 
     int *a = new int[n];
@@ -103,33 +75,17 @@ int main(int argc, const char **argv) {
         a[i] = rand() % rand_max;
     }
 
-    // Copy array a to b
-    std::copy(a, a + n, b);
+    // Every run sorts a fresh copy of the input, restored outside of the timing
+    auto reset = [&] { std::copy(a, a + n, b); };
 
     // Output generated array details
-    std::cout << "Generated random array of length " << n 
-              << " with elements between 0 and " << rand_max << "\n\n";
+    bench.note("Generated random array of length " + to_string(n) + " with elements between 0 and " +
+               to_string(rand_max) + "\n");
 
-    // Assuming bench_traverse is defined and returns execution time
-    std::cout << "Sequential Bubble sort: " 
-              << bench_traverse([&] { s_bubble(a, n); }) 
-              << "ms\n";
+    bench.run("Sequential Bubble sort", [&] { s_bubble(b, n); }, reset);
+    bench.sweep("Parallel Bubble sort", [&] { p_bubble(b, n); }, reset);
 
-    cout << "Sorted array is ready =>\n";
     // Uncomment to print sorted array if needed
-    // for (int i = 0; i < n; i++) {
-    //     cout << a[i] << ", ";
-    // }
-    cout << "\n\n";
-
-    omp_set_num_threads(16);  // Set the number of threads for parallel processing
-
-    // Parallel Bubble Sort
-    std::cout << "Parallel (16) Bubble sort: " 
-              << bench_traverse([&] { p_bubble(b, n); }) 
-              << "ms\n";
-
-    // Uncomment to print sorted parallel array if needed
     // cout << "Sorted array is =>\n";
     // for (int i = 0; i < n; i++) {
     //     cout << b[i] << ", ";
@@ -141,4 +97,3 @@ int main(int argc, const char **argv) {
 
     return 0;
 }
-
@@ -0,0 +1,94 @@
+// To compile:
+// g++ -std=c++17 -O2 -march=native -fopenmp external_sort.cpp -o external_sort
+// To run:
+// ./external_sort <input.bin> <output.bin> [--memory=MB] [--generate=N] [--warmup=N] [--samples=N] [--threads=1,2,4]
+//
+// Sorts a binary file of native-endian ints that may be larger than memory.
+// --generate=N first writes N random ints to the input file. Every run sorts
+// the whole file, so by default it is sorted once, untimed warmup skipped, on
+// all threads.
+
+#include <omp.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../common/bench.hpp"
+#include "external_sort.hpp"
+
+using namespace std;
+
+// Write n random ints to path, a chunk at a time
+void generate_input(const string &path, size_t n) {
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file) {
+        throw invalid_argument("Input file is not writable.");
+    }
+    vector<int> chunk(size_t(1) << 20);
+    for (size_t done = 0; done < n; done += chunk.size()) {
+        size_t count = min(chunk.size(), n - done);
+        for (size_t i = 0; i < count; i++) chunk[i] = rand();
+        write_ints(file, chunk.data(), count);
+    }
+}
+
+// True when path holds ints in ascending order
+bool is_sorted_file(const string &path) {
+    ifstream file(path, ios::binary);
+    vector<int> chunk(size_t(1) << 20);
+    int last = INT_MIN;
+    for (size_t got; (got = read_ints(file, chunk.data(), chunk.size())) > 0;) {
+        if (chunk[0] < last || !is_sorted(chunk.begin(), chunk.begin() + got)) return false;
+        last = chunk[got - 1];
+    }
+    return true;
+}
+
+int main(int argc, const char **argv) {
+    BenchOptions bench_options = BenchOptions::from_args(argc, argv);
+    auto given = [&](const string &flag) {
+        return any_of(argv + 1, argv + argc, [&](const char *arg) { return string(arg).rfind(flag, 0) == 0; });
+    };
+    if (!given("--warmup=")) bench_options.warmup = 0;
+    if (!given("--samples=")) bench_options.samples = 1;
+    if (!given("--threads=")) bench_options.threads = {omp_get_max_threads()};
+    Bench bench(bench_options);
+    vector<string> args;
+    ExternalSortOptions options;
+    size_t generate = 0;
+    for (const auto &arg : bench.config().args) {
+        if (arg.rfind("--memory=", 0) == 0) {
+            options.memory = stoull(arg.substr(9)) << 20;
+        } else if (arg.rfind("--generate=", 0) == 0) {
+            generate = stoull(arg.substr(11));
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.size() < 2) {
+        cerr << "Usage: " << argv[0] << " <input.bin> <output.bin> [--memory=MB] [--generate=N]\n";
+        return 1;
+    }
+
+    try {
+        if (generate > 0) {
+            generate_input(args[0], generate);
+        }
+
+        // Run sorting and merging use every OpenMP thread
+        ExternalSortStats stats;
+        bench.sweep("External sort", [&]() { stats = external_sort(args[0], args[1], options); });
+
+        bench.note("Sorted " + to_string(stats.elements) + " ints in " + to_string(stats.runs) + " runs and " +
+                   to_string(stats.merge_passes) + " merge passes, output " +
+                   (is_sorted_file(args[1]) ? "verified" : "NOT sorted"));
+    } catch (const exception &ex) {
+        cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
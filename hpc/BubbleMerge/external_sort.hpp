@@ -0,0 +1,294 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sort.hpp"
+
+// External merge sort of binary files of native-endian ints that do not fit in
+// memory. Run formation streams the input in chunks, sorts each chunk with
+// p_merge_sort and spills it as a sorted run, with the next chunk being read
+// and the previous run being written while the current one sorts. The runs are
+// then k-way merged through a loser tree, every run and the output going
+// through a pair of buffers so that disk I/O overlaps the merge. When there
+// are more runs than fit in memory at a useful buffer size, groups of runs are
+// merged into longer runs first.
+
+struct ExternalSortOptions {
+    // Memory budget for buffers and the in-memory sort, in bytes
+    size_t memory = size_t(256) << 20;
+    // Prefix for the temporary run files, the output path when empty
+    std::string temp_prefix;
+};
+
+struct ExternalSortStats {
+    size_t elements = 0;
+    size_t runs = 0;
+    int merge_passes = 0;
+};
+
+// Smallest per-run merge buffer, in elements, before runs are merged in groups
+const size_t external_min_buffer = size_t(64) << 10;
+
+// Read up to count ints from file into data, returning how many were read
+inline size_t read_ints(std::ifstream &file, int *data, size_t count) {
+    file.read(reinterpret_cast<char *>(data), std::streamsize(count * sizeof(int)));
+    if (file.bad()) {
+        throw std::runtime_error("Failed to read from a sort input file.");
+    }
+    size_t bytes = size_t(file.gcount());
+    if (bytes % sizeof(int) != 0) {
+        throw std::invalid_argument("Input file size is not a multiple of the int size.");
+    }
+    return bytes / sizeof(int);
+}
+
+inline void write_ints(std::ofstream &file, const int *data, size_t count) {
+    file.write(reinterpret_cast<const char *>(data), std::streamsize(count * sizeof(int)));
+    if (!file) {
+        throw std::runtime_error("Failed to write a sort output file.");
+    }
+}
+
+// Sequential reader of one sorted run, refilling one buffer in the background
+// while the merge consumes the other. The background read refers to the
+// reader, so readers are kept in a deque and never move
+class RunReader {
+   public:
+    RunReader(const std::string &path, size_t buffer_elems)
+        : file(path, std::ios::binary), current(buffer_elems), next(buffer_elems) {
+        if (!file) {
+            throw std::invalid_argument("Run file does not exist or is not readable.");
+        }
+        prefetch();
+        advance();
+    }
+
+    ~RunReader() {
+        if (pending.valid()) pending.wait();
+    }
+
+    bool done() const { return pos == size; }
+    int head() const { return current[pos]; }
+
+    void pop() {
+        if (++pos == size) advance();
+    }
+
+   private:
+    void prefetch() {
+        pending = std::async(std::launch::async, [this] { return read_ints(file, next.data(), next.size()); });
+    }
+
+    // Swap in the prefetched buffer and start reading the one after it
+    void advance() {
+        size = pending.get();
+        pos = 0;
+        std::swap(current, next);
+        if (size > 0) prefetch();
+    }
+
+    std::ifstream file;
+    std::vector<int> current, next;
+    std::future<size_t> pending;
+    size_t pos = 0, size = 0;
+};
+
+// Buffered writer that hands full buffers to a background write
+class RunWriter {
+   public:
+    RunWriter(const std::string &path, size_t buffer_elems)
+        : file(path, std::ios::binary | std::ios::trunc), buffer_elems(buffer_elems) {
+        if (!file) {
+            throw std::invalid_argument("Output file is not writable.");
+        }
+        current.reserve(buffer_elems);
+        flushing.reserve(buffer_elems);
+    }
+
+    ~RunWriter() {
+        if (pending.valid()) pending.wait();
+    }
+
+    void push(int v) {
+        current.push_back(v);
+        if (current.size() == buffer_elems) flush();
+    }
+
+    void close() {
+        flush();
+        if (pending.valid()) pending.get();
+        file.close();
+    }
+
+   private:
+    void flush() {
+        if (pending.valid()) pending.get();
+        std::swap(current, flushing);
+        current.clear();
+        pending = std::async(std::launch::async, [this] { write_ints(file, flushing.data(), flushing.size()); });
+    }
+
+    std::ofstream file;
+    size_t buffer_elems;
+    std::vector<int> current, flushing;
+    std::future<void> pending;
+};
+
+// Tournament tree over the heads of k runs. Each internal node keeps the loser
+// of the match played there and tree[0] the overall winner, so replacing the
+// winner's head replays only the log k matches on its path to the root.
+// Exhausted runs lose every match; ties go to the lower run index.
+class LoserTree {
+   public:
+    explicit LoserTree(std::deque<RunReader> &runs) : runs(runs), k(int(runs.size())), tree(runs.size()) {
+        std::vector<int> winners(2 * k);
+        for (int i = 0; i < k; i++) winners[k + i] = i;
+        for (int node = k - 1; node >= 1; node--) {
+            int a = winners[2 * node], b = winners[2 * node + 1];
+            winners[node] = beats(a, b) ? a : b;
+            tree[node] = beats(a, b) ? b : a;
+        }
+        tree[0] = winners[1];
+    }
+
+    bool done() const { return runs[tree[0]].done(); }
+    int top() const { return runs[tree[0]].head(); }
+
+    void pop() {
+        int w = tree[0];
+        runs[w].pop();
+        for (int node = (w + k) / 2; node >= 1; node /= 2) {
+            if (beats(tree[node], w)) std::swap(tree[node], w);
+        }
+        tree[0] = w;
+    }
+
+   private:
+    bool beats(int a, int b) const {
+        if (runs[a].done()) return false;
+        if (runs[b].done()) return true;
+        return runs[a].head() < runs[b].head() || (runs[a].head() == runs[b].head() && a < b);
+    }
+
+    std::deque<RunReader> &runs;
+    int k;
+    std::vector<int> tree;
+};
+
+// Merge the sorted run files in paths into output
+inline void merge_runs_to_file(const std::vector<std::string> &paths, const std::string &output, size_t buffer_elems) {
+    std::deque<RunReader> runs;
+    for (const auto &path : paths) runs.emplace_back(path, buffer_elems);
+
+    RunWriter writer(output, buffer_elems);
+    LoserTree tree(runs);
+    while (!tree.done()) {
+        writer.push(tree.top());
+        tree.pop();
+    }
+    writer.close();
+}
+
+inline ExternalSortStats external_sort(const std::string &input, const std::string &output,
+                                       const ExternalSortOptions &options = {}) {
+    ExternalSortStats stats;
+    std::string prefix = options.temp_prefix.empty() ? output : options.temp_prefix;
+    size_t budget = std::max<size_t>(options.memory / sizeof(int), 4 * external_min_buffer);
+
+    std::ifstream in(input, std::ios::binary);
+    if (!in) {
+        throw std::invalid_argument("Input file does not exist or is not readable.");
+    }
+
+    // Run formation holds the chunk being read, sorted and written, plus the
+    // auxiliary buffer of p_merge_sort. An input smaller than that is read in
+    // one chunk of its own size
+    size_t chunk = budget / 4;
+    in.seekg(0, std::ios::end);
+    std::streamoff size = in.tellg();
+    in.seekg(0, std::ios::beg);
+    if (size >= 0) {
+        chunk = std::max<size_t>(1, std::min(chunk, size_t(size) / sizeof(int)));
+    } else {
+        // Not seekable, so the size is unknown and the chunk stays at the budget
+        in.clear();
+    }
+    std::vector<std::string> paths;
+    {
+        std::vector<int> bufs[3];
+        for (auto &buf : bufs) buf.resize(chunk);
+        auto read_chunk = [&](int b) {
+            return std::async(std::launch::async, [&, b] { return read_ints(in, bufs[b].data(), chunk); });
+        };
+
+        std::future<size_t> reading = read_chunk(0);
+        std::future<void> writing;
+        std::ofstream run_file;
+        for (int r = 0;; r = (r + 1) % 3) {
+            size_t got = reading.get();
+            if (got == 0) break;
+            // The buffer after this one was last written out two runs ago
+            reading = read_chunk((r + 1) % 3);
+
+            p_merge_sort(bufs[r].begin(), bufs[r].begin() + got);
+
+            if (writing.valid()) writing.get();
+            paths.push_back(prefix + ".run" + std::to_string(paths.size()));
+            run_file = std::ofstream(paths.back(), std::ios::binary | std::ios::trunc);
+            if (!run_file) {
+                throw std::invalid_argument("Temporary run file is not writable.");
+            }
+            writing = std::async(std::launch::async, [&, r, got] {
+                write_ints(run_file, bufs[r].data(), got);
+                run_file.close();
+            });
+            stats.elements += got;
+        }
+        if (writing.valid()) writing.get();
+    }
+    stats.runs = paths.size();
+
+    if (paths.empty()) {
+        RunWriter(output, 1).close();
+        return stats;
+    }
+
+    // Every run and the output get two buffers of at least external_min_buffer
+    size_t fan_in = std::max<size_t>(2, budget / (2 * external_min_buffer) - 1);
+    size_t generation = 0;
+    while (paths.size() > fan_in) {
+        std::vector<std::string> merged;
+        for (size_t begin = 0; begin < paths.size(); begin += fan_in) {
+            std::vector<std::string> group(paths.begin() + begin,
+                                           paths.begin() + std::min(paths.size(), begin + fan_in));
+            merged.push_back(prefix + ".pass" + std::to_string(generation) + "." + std::to_string(merged.size()));
+            merge_runs_to_file(group, merged.back(), budget / (2 * (group.size() + 1)));
+            for (const auto &path : group) std::remove(path.c_str());
+        }
+        paths = std::move(merged);
+        generation++;
+        stats.merge_passes++;
+    }
+
+    if (paths.size() == 1) {
+        std::remove(output.c_str());
+        if (std::rename(paths[0].c_str(), output.c_str()) != 0) {
+            merge_runs_to_file(paths, output, chunk);
+        }
+    } else {
+        merge_runs_to_file(paths, output, budget / (2 * (paths.size() + 1)));
+        stats.merge_passes++;
+    }
+    for (const auto &path : paths) std::remove(path.c_str());
+
+    return stats;
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+// LSD radix sort for arrays of int, int64_t, uint32_t, uint64_t, float and
+// double keys, or of trivially copyable records sorted by such a key through a
+// projection. The sort is stable, so records with equal keys keep their order.
+//
+// Keys are mapped to unsigned integers and offset by the smallest key, so the
+// number of passes only depends on the key range: rand() % rand_max input with
+// rand_max <= 2048 sorts in a single pass. Each pass builds per-thread
+// histograms over a contiguous block, prefix sums them into per-thread scatter
+// offsets and scatters through write-combining buffers, one cache line per
+// digit, so the destination is written a whole line at a time. Only the
+// per-thread counters fit in L1: at the widest digit the buffers take 2^11
+// lines, 128 KB per thread, and live in L2.
+
+template <typename T>
+struct RadixTraits;
+
+template <>
+struct RadixTraits<int> {
+    using Key = uint32_t;
+    // Flip the sign bit so negative values order before positive ones
+    static Key key(int v) { return uint32_t(v) ^ 0x80000000u; }
+};
+
+template <>
+struct RadixTraits<uint32_t> {
+    using Key = uint32_t;
+    static Key key(uint32_t v) { return v; }
+};
+
+template <>
+struct RadixTraits<int64_t> {
+    using Key = uint64_t;
+    static Key key(int64_t v) { return uint64_t(v) ^ (uint64_t(1) << 63); }
+};
+
+template <>
+struct RadixTraits<uint64_t> {
+    using Key = uint64_t;
+    static Key key(uint64_t v) { return v; }
+};
+
+// IEEE floats order like sign-magnitude integers: flip every bit of negative
+// values and only the sign bit of positive ones
+template <>
+struct RadixTraits<float> {
+    using Key = uint32_t;
+    static Key key(float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : bits ^ 0x80000000u;
+    }
+};
+
+template <>
+struct RadixTraits<double> {
+    using Key = uint64_t;
+    static Key key(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return (bits >> 63) ? ~bits : bits ^ (uint64_t(1) << 63);
+    }
+};
+
+// True when T has RadixTraits, so radix_sort can order it
+template <typename T, typename = void>
+struct is_radix_key : std::false_type {};
+
+template <typename T>
+struct is_radix_key<T, std::void_t<typename RadixTraits<T>::Key>> : std::true_type {};
+
+// Widest digit used by a pass; the 2^11 counters and fill levels of a thread
+// take 16 KB each, the write-combining buffers 128 KB
+const int radix_max_digit_bits = 11;
+
+// Sort a[0..n) by the key proj(a[i])
+template <typename T, typename Proj>
+void radix_sort(T *a, size_t n, Proj proj, bool parallel) {
+    static_assert(std::is_trivially_copyable<T>::value, "radix_sort moves elements with memcpy");
+    using Traits = RadixTraits<std::decay_t<std::invoke_result_t<Proj &, const T &>>>;
+    using Key = typename Traits::Key;
+    if (n < 2) return;
+
+    auto key = [&](const T &v) { return Traits::key(std::invoke(proj, v)); };
+
+    Key lo = ~Key(0), hi = 0;
+    #pragma omp parallel for reduction(min : lo) reduction(max : hi) if (parallel)
+    for (size_t i = 0; i < n; i++) {
+        Key k = key(a[i]);
+        lo = std::min(lo, k);
+        hi = std::max(hi, k);
+    }
+
+    // Pick the fewest passes that cover the key range, then split the bits
+    // evenly between them
+    int bits = 0;
+    for (Key span = hi - lo; span != 0; span >>= 1) bits++;
+    if (bits == 0) return;
+    int passes = (bits + radix_max_digit_bits - 1) / radix_max_digit_bits;
+    int digit_bits = (bits + passes - 1) / passes;
+    size_t radix = size_t(1) << digit_bits;
+    Key mask = Key(radix - 1);
+
+    // Elements per write-combining buffer, one cache line each
+    const size_t line = std::max<size_t>(1, 64 / sizeof(T));
+
+    std::vector<T> tmp(n);
+    int max_threads = parallel ? omp_get_max_threads() : 1;
+    std::vector<size_t> offsets(size_t(max_threads) * radix);
+
+    #pragma omp parallel num_threads(max_threads)
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        size_t begin = n * t / nt;
+        size_t end = n * (t + 1) / nt;
+        size_t *hist = &offsets[size_t(t) * radix];
+
+        std::vector<T> wc(radix * line);
+        std::vector<size_t> fill(radix);
+
+        T *src = a;
+        T *dst = tmp.data();
+        for (int pass = 0; pass < passes; pass++) {
+            int shift = pass * digit_bits;
+            auto digit = [&](const T &v) { return size_t(((key(v) - lo) >> shift) & mask); };
+
+            std::fill(hist, hist + radix, 0);
+            for (size_t i = begin; i < end; i++) {
+                hist[digit(src[i])]++;
+            }
+            #pragma omp barrier
+
+            // Turn the counts into scatter offsets: digit-major, then by thread
+            // so that each thread's block keeps its relative order
+            #pragma omp single
+            {
+                size_t running = 0;
+                for (size_t d = 0; d < radix; d++) {
+                    for (int u = 0; u < nt; u++) {
+                        size_t count = offsets[size_t(u) * radix + d];
+                        offsets[size_t(u) * radix + d] = running;
+                        running += count;
+                    }
+                }
+            }
+
+            std::fill(fill.begin(), fill.end(), 0);
+            for (size_t i = begin; i < end; i++) {
+                size_t d = digit(src[i]);
+                T *buffer = &wc[d * line];
+                buffer[fill[d]++] = src[i];
+                if (fill[d] == line) {
+                    std::memcpy(dst + hist[d], buffer, line * sizeof(T));
+                    hist[d] += line;
+                    fill[d] = 0;
+                }
+            }
+            for (size_t d = 0; d < radix; d++) {
+                std::memcpy(dst + hist[d], &wc[d * line], fill[d] * sizeof(T));
+                hist[d] += fill[d];
+            }
+            #pragma omp barrier
+
+            std::swap(src, dst);
+        }
+
+        // An odd number of passes leaves the result in tmp
+        if (passes % 2 == 1) {
+            std::copy(tmp.data() + begin, tmp.data() + end, a + begin);
+        }
+    }
+}
+
+template <typename T>
+void radix_sort(T *a, size_t n, bool parallel) {
+    radix_sort(a, n, [](const T &v) { return v; }, parallel);
+}
+
+template <typename T>
+void s_radix_sort(T *a, size_t n) {
+    radix_sort(a, n, false);
+}
+
+template <typename T>
+void p_radix_sort(T *a, size_t n) {
+    radix_sort(a, n, true);
+}
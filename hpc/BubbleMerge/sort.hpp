@@ -0,0 +1,442 @@
+#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "radix_sort.hpp"
+#include "sort_network.hpp"
+
+// Generic versions of the sorts in this directory over random access
+// iterators, a comparator and an optional projection, as in
+//
+//     merge_sort(v.begin(), v.end());
+//     p_merge_sort(recs.begin(), recs.end(), std::greater<>(), &Record::key);
+//     p_radix_sort_by(recs.data(), recs.data() + recs.size(), &Record::key);
+//
+// The elements are ordered by comp(proj(a), proj(b)). Merge sort and radix
+// sort are stable. When the range is contiguous and its elements are trivially
+// copyable the auxiliary buffer is filled with memcpy, and int ranges in the
+// default order go through the sorting network and vector merge of
+// sort_network.hpp.
+
+// Projection that leaves the element as it is
+struct Identity {
+    template <typename T>
+    T &&operator()(T &&v) const { return std::forward<T>(v); }
+};
+
+// Strict weak order on elements built from a comparator and a projection
+template <typename Comp, typename Proj>
+struct ProjectedLess {
+    Comp comp;
+    Proj proj;
+
+    template <typename A, typename B>
+    bool operator()(const A &a, const B &b) const {
+        return std::invoke(comp, std::invoke(proj, a), std::invoke(proj, b));
+    }
+};
+
+// Below this many elements a merge sort range is insertion sorted
+const std::ptrdiff_t generic_sort_base = 32;
+// Below this many elements a merge sort range is not split into tasks
+const std::ptrdiff_t generic_task_base = 1000;
+// Below this many output elements a merge piece is not worth its own task
+const std::ptrdiff_t generic_merge_grain = 8192;
+
+// True when elements of It sit contiguously in memory, so they can be handled
+// through plain pointers
+template <typename It>
+constexpr bool is_contiguous_iterator() {
+    using T = typename std::iterator_traits<It>::value_type;
+    return std::is_pointer<It>::value ||
+           (!std::is_same<T, bool>::value && std::is_same<It, typename std::vector<T>::iterator>::value);
+}
+
+// True when sorting with this order is the same as sorting ints ascending, so
+// the SIMD kernels, which do not preserve the order of equal elements, are safe
+template <typename T, typename Comp, typename Proj>
+constexpr bool is_network_sortable() {
+    return std::is_same<T, int>::value && std::is_same<Proj, Identity>::value &&
+           (std::is_same<Comp, std::less<>>::value || std::is_same<Comp, std::less<int>>::value);
+}
+
+// Stable merge of x[0..nx) and y[0..ny) into out, taking from x on ties
+template <typename Src, typename Dst, typename Less>
+void merge_runs(Src x, std::ptrdiff_t nx, Src y, std::ptrdiff_t ny, Dst out, const Less &less) {
+    std::ptrdiff_t i = 0, j = 0;
+    while (i < nx && j < ny) {
+        if (less(y[j], x[i])) {
+            *out++ = std::move(y[j++]);
+        } else {
+            *out++ = std::move(x[i++]);
+        }
+    }
+    out = std::move(x + i, x + nx, out);
+    std::move(y + j, y + ny, out);
+}
+
+// Number of elements the first k outputs of merge_runs take from x
+template <typename Src, typename Less>
+std::ptrdiff_t merge_co_rank(std::ptrdiff_t k, Src x, std::ptrdiff_t nx, Src y, std::ptrdiff_t ny,
+                             const Less &less) {
+    std::ptrdiff_t lo = std::max<std::ptrdiff_t>(0, k - ny), hi = std::min(k, nx);
+    while (lo < hi) {
+        std::ptrdiff_t i = lo + (hi - lo) / 2;
+        // x[i] still belongs in the first k outputs, ties going to x
+        if (!less(y[k - i - 1], x[i])) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+template <bool Network, typename Src, typename Dst, typename Less>
+void p_merge_runs(Src x, std::ptrdiff_t nx, Src y, std::ptrdiff_t ny, Dst out, const Less &less) {
+    if (nx + ny <= generic_merge_grain) {
+        if constexpr (Network) {
+            merge_into(x, int(nx), y, int(ny), out);
+        } else {
+            merge_runs(x, nx, y, ny, out, less);
+        }
+        return;
+    }
+    std::ptrdiff_t k = (nx + ny) / 2;
+    std::ptrdiff_t i = merge_co_rank(k, x, nx, y, ny, less);
+    #pragma omp task
+    p_merge_runs<Network>(x, i, y, k - i, out, less);
+    p_merge_runs<Network>(x + i, nx - i, y + (k - i), ny - (k - i), out + k, less);
+    #pragma omp taskwait
+}
+
+// Stable insertion sort of a[0..n)
+template <typename It, typename Less>
+void insertion_sort(It a, std::ptrdiff_t n, const Less &less) {
+    for (std::ptrdiff_t i = 1; i < n; i++) {
+        auto v = std::move(a[i]);
+        std::ptrdiff_t k = i - 1;
+        while (k >= 0 && less(v, a[k])) {
+            a[k + 1] = std::move(a[k]);
+            k--;
+        }
+        a[k + 1] = std::move(v);
+    }
+}
+
+// Sort dst[lo, hi) given that src[lo, hi) holds the same elements. Each level
+// sorts its halves into src and merges them back into dst, so the two buffers
+// swap roles on the way down and no merge allocates or copies back
+template <bool Network, typename Src, typename Dst, typename Less>
+void sort_runs_into(Src src, Dst dst, std::ptrdiff_t lo, std::ptrdiff_t hi, const Less &less) {
+    if constexpr (Network) {
+        if (hi - lo <= network_block) {
+            small_sort(&dst[lo], int(hi - lo));
+            return;
+        }
+    } else if (hi - lo <= generic_sort_base) {
+        insertion_sort(dst + lo, hi - lo, less);
+        return;
+    }
+    std::ptrdiff_t mid = lo + (hi - lo) / 2;
+    sort_runs_into<Network>(dst, src, lo, mid, less);
+    sort_runs_into<Network>(dst, src, mid, hi, less);
+    if constexpr (Network) {
+        merge_into(&src[lo], int(mid - lo), &src[mid], int(hi - mid), &dst[lo]);
+    } else {
+        merge_runs(src + lo, mid - lo, src + mid, hi - mid, dst + lo, less);
+    }
+}
+
+template <bool Network, typename Src, typename Dst, typename Less>
+void p_sort_runs_into(Src src, Dst dst, std::ptrdiff_t lo, std::ptrdiff_t hi, const Less &less) {
+    if (hi - lo <= generic_task_base) {
+        sort_runs_into<Network>(src, dst, lo, hi, less);
+        return;
+    }
+    std::ptrdiff_t mid = lo + (hi - lo) / 2;
+    #pragma omp task
+    p_sort_runs_into<Network>(dst, src, lo, mid, less);
+    #pragma omp task
+    p_sort_runs_into<Network>(dst, src, mid, hi, less);
+    #pragma omp taskwait
+    p_merge_runs<Network>(src + lo, mid - lo, src + mid, hi - mid, dst + lo, less);
+}
+
+// Run sort(aux, first) with aux a second copy of [first, last). Contiguous
+// ranges of trivially copyable elements are sorted through raw pointers and
+// copied into an uninitialised buffer with memcpy, split across the threads
+// when parallel is set
+template <typename It, typename Sort>
+void with_sort_buffer(It first, It last, bool parallel, Sort sort) {
+    using T = typename std::iterator_traits<It>::value_type;
+    std::ptrdiff_t n = last - first;
+    if constexpr (is_contiguous_iterator<It>() && std::is_trivially_copyable<T>::value &&
+                  std::is_trivially_default_constructible<T>::value) {
+        T *a = &*first;
+        std::unique_ptr<T[]> aux(new T[n]);
+        #pragma omp parallel if (parallel)
+        {
+            int t = omp_get_thread_num(), nt = omp_get_num_threads();
+            std::ptrdiff_t begin = n * t / nt, end = n * (t + 1) / nt;
+            std::memcpy(aux.get() + begin, a + begin, (end - begin) * sizeof(T));
+        }
+        sort(aux.get(), a);
+    } else {
+        std::vector<T> aux(first, last);
+        sort(aux.begin(), first);
+    }
+}
+
+template <typename It, typename Comp = std::less<>, typename Proj = Identity>
+void merge_sort(It first, It last, Comp comp = {}, Proj proj = {}) {
+    using T = typename std::iterator_traits<It>::value_type;
+    constexpr bool network = is_contiguous_iterator<It>() && is_network_sortable<T, Comp, Proj>();
+    ProjectedLess<Comp, Proj> less{comp, proj};
+    std::ptrdiff_t n = last - first;
+    if (n < 2) return;
+    with_sort_buffer(first, last, false, [&](auto src, auto dst) {
+        sort_runs_into<network>(src, dst, 0, n, less);
+    });
+}
+
+template <typename It, typename Comp = std::less<>, typename Proj = Identity>
+void p_merge_sort(It first, It last, Comp comp = {}, Proj proj = {}) {
+    using T = typename std::iterator_traits<It>::value_type;
+    constexpr bool network = is_contiguous_iterator<It>() && is_network_sortable<T, Comp, Proj>();
+    ProjectedLess<Comp, Proj> less{comp, proj};
+    std::ptrdiff_t n = last - first;
+    if (n < 2) return;
+    with_sort_buffer(first, last, true, [&](auto src, auto dst) {
+        #pragma omp parallel
+        {
+            #pragma omp single
+            p_sort_runs_into<network>(src, dst, 0, n, less);
+        }
+    });
+}
+
+// Oversampling factor: sample elements drawn per bucket to pick its splitter
+const std::ptrdiff_t sample_oversampling = 32;
+// Below this many elements p_sample_sort hands over to p_merge_sort
+const std::ptrdiff_t sample_sort_min = 1 << 16;
+
+// Splitters of a sample sort for p threads, picked from a sorted random
+// sample of sample_oversampling elements per thread. Repeated splitters are
+// dropped and every remaining one gets an equality bucket: bucket 2j holds
+// the elements strictly between splitters j - 1 and j, and bucket 2j + 1
+// those equal to splitter j, which need no sorting. A key frequent enough to
+// fill several sample positions so ends up alone in its own bucket instead
+// of piling into the bucket after it.
+template <typename T, typename Less>
+struct SampleSplitters {
+    std::vector<T> splitters;
+    Less less;
+
+    SampleSplitters(const T *a, std::ptrdiff_t n, int p, const Less &less) : less(less) {
+        std::vector<T> sample;
+        sample.reserve(size_t(p) * sample_oversampling);
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        for (std::ptrdiff_t k = 0; k < p * sample_oversampling; k++) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            sample.push_back(a[(state >> 33) % uint64_t(n)]);
+        }
+        std::sort(sample.begin(), sample.end(), less);
+        for (int b = 1; b < p; b++) {
+            const T &s = sample[b * sample_oversampling];
+            if (splitters.empty() || less(splitters.back(), s)) splitters.push_back(s);
+        }
+    }
+
+    int buckets() const { return 2 * int(splitters.size()) + 1; }
+
+    static bool is_equal_bucket(int b) { return b % 2 == 1; }
+
+    int bucket(const T &x) const {
+        int j = int(std::upper_bound(splitters.begin(), splitters.end(), x, less) - splitters.begin());
+        // x is not below splitter j - 1, so it equals it unless it is above
+        return j > 0 && !less(splitters[j - 1], x) ? 2 * j - 1 : 2 * j;
+    }
+};
+
+// Parallel sample sort of a contiguous range, about one bucket per thread
+// from SampleSplitters. Each thread classifies its block once, recording
+// bucket numbers and counts, and after a prefix sum scatters the block into
+// the auxiliary buffer in order. Buckets are then merge sorted independently
+// back into the range, so the data crosses memory a constant number of times
+// before the local sorts instead of once per merge level. Stable like
+// merge_sort.
+template <typename It, typename Comp = std::less<>, typename Proj = Identity>
+void p_sample_sort(It first, It last, Comp comp = {}, Proj proj = {}) {
+    static_assert(is_contiguous_iterator<It>(), "p_sample_sort needs contiguous storage");
+    using T = typename std::iterator_traits<It>::value_type;
+    using Less = ProjectedLess<Comp, Proj>;
+    constexpr bool network = is_network_sortable<T, Comp, Proj>();
+    Less less{comp, proj};
+    std::ptrdiff_t n = last - first;
+    // Bucket numbers, up to 2p - 1 of them, are stored as 16 bits
+    int p = std::min(omp_get_max_threads(), 1 << 15);
+    if (p < 2 || n < sample_sort_min) {
+        p_merge_sort(first, last, comp, proj);
+        return;
+    }
+    T *a = &*first;
+
+    const SampleSplitters<T, Less> split(a, n, p, less);
+    const int nb = split.buckets();
+    std::vector<uint16_t> bucket_of(n);
+    std::vector<std::ptrdiff_t> offsets(size_t(p) * nb);
+    std::vector<std::ptrdiff_t> bucket_begin(nb + 1);
+    std::unique_ptr<T[]> aux(new T[n]);
+
+    #pragma omp parallel num_threads(p)
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        std::ptrdiff_t begin = n * t / nt, end = n * (t + 1) / nt;
+        std::ptrdiff_t *next = &offsets[size_t(t) * nb];
+
+        for (std::ptrdiff_t i = begin; i < end; i++) {
+            int b = split.bucket(a[i]);
+            bucket_of[i] = uint16_t(b);
+            next[b]++;
+        }
+        #pragma omp barrier
+
+        // Bucket-major, then by thread, so every bucket keeps the input order
+        #pragma omp single
+        {
+            std::ptrdiff_t running = 0;
+            for (int b = 0; b < nb; b++) {
+                bucket_begin[b] = running;
+                for (int u = 0; u < nt; u++) {
+                    std::ptrdiff_t count = offsets[size_t(u) * nb + b];
+                    offsets[size_t(u) * nb + b] = running;
+                    running += count;
+                }
+            }
+            bucket_begin[nb] = running;
+        }
+
+        for (std::ptrdiff_t i = begin; i < end; i++) {
+            aux[next[bucket_of[i]]++] = std::move(a[i]);
+        }
+        #pragma omp barrier
+
+        // Equality buckets are already in place once copied back, and a large
+        // one is copied by every thread rather than the one owning it
+        #pragma omp for schedule(static)
+        for (std::ptrdiff_t i = 0; i < n; i++) a[i] = aux[i];
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int b = 0; b < nb; b++) {
+            if (SampleSplitters<T, Less>::is_equal_bucket(b)) continue;
+            sort_runs_into<network>(aux.get(), a, bucket_begin[b], bucket_begin[b + 1], less);
+        }
+    }
+}
+
+// Sizes of the buckets p_sample_sort would cut [first, last) into on the
+// current number of threads, e.g. to check their balance on skewed keys
+template <typename It, typename Comp = std::less<>, typename Proj = Identity>
+std::vector<std::ptrdiff_t> sample_sort_buckets(It first, It last, Comp comp = {}, Proj proj = {}) {
+    using T = typename std::iterator_traits<It>::value_type;
+    using Less = ProjectedLess<Comp, Proj>;
+    std::ptrdiff_t n = last - first;
+    int p = std::min(omp_get_max_threads(), 1 << 15);
+    if (p < 2 || n < sample_sort_min) return {n};
+    const SampleSplitters<T, Less> split(&*first, n, p, Less{comp, proj});
+    std::vector<std::ptrdiff_t> sizes(split.buckets());
+    for (std::ptrdiff_t i = 0; i < n; i++) sizes[split.bucket(first[i])]++;
+    return sizes;
+}
+
+// Odd-even transposition sort, the generic s_bubble
+template <typename It, typename Comp = std::less<>, typename Proj = Identity>
+void bubble_sort(It first, It last, Comp comp = {}, Proj proj = {}) {
+    ProjectedLess<Comp, Proj> less{comp, proj};
+    std::ptrdiff_t n = last - first;
+    for (std::ptrdiff_t i = 0; i < n; i++) {
+        for (std::ptrdiff_t j = i % 2; j < n - 1; j += 2) {
+            if (less(first[j + 1], first[j])) std::iter_swap(first + j, first + j + 1);
+        }
+    }
+}
+
+// Target size of one block of the parallel odd-even sort, about an L2 cache
+const size_t bubble_block_bytes = 256 * 1024;
+
+// Block odd-even transposition sort, the generic p_bubble. The range is cut into
+// at least one block per thread, each block is sorted locally, and phases then
+// merge-split alternately the even and odd pairs of neighbouring blocks so the
+// lower block keeps the smaller half. Threads own whole blocks, so no cache
+// line is written by two of them, and the sort stops once an even and an odd
+// phase in a row move nothing. Everything runs in one parallel region.
+template <typename It, typename Comp = std::less<>, typename Proj = Identity>
+void p_bubble_sort(It first, It last, Comp comp = {}, Proj proj = {}) {
+    using T = typename std::iterator_traits<It>::value_type;
+    ProjectedLess<Comp, Proj> less{comp, proj};
+    std::ptrdiff_t n = last - first;
+    if (n < 2) return;
+
+    std::ptrdiff_t block_elems = std::max<std::ptrdiff_t>(1, bubble_block_bytes / sizeof(T));
+    std::ptrdiff_t blocks = std::max<std::ptrdiff_t>(omp_get_max_threads(), (n + block_elems - 1) / block_elems);
+    blocks = std::min(blocks, n);
+    auto bound = [&](std::ptrdiff_t b) { return first + n * b / blocks; };
+
+    bool changed = false;
+    #pragma omp parallel
+    {
+        std::vector<T> scratch;
+
+        #pragma omp for schedule(static)
+        for (std::ptrdiff_t b = 0; b < blocks; b++) {
+            std::stable_sort(bound(b), bound(b + 1), less);
+        }
+
+        // A first quiet phase only proves half of the block boundaries ordered
+        bool prev_changed = true;
+        for (std::ptrdiff_t phase = 0;; phase++) {
+            #pragma omp for schedule(static) reduction(|| : changed)
+            for (std::ptrdiff_t b = phase % 2; b < blocks - 1; b += 2) {
+                It lo = bound(b), mid = bound(b + 1), hi = bound(b + 2);
+                if (!less(*mid, *(mid - 1))) continue;
+                scratch.clear();
+                std::merge(std::make_move_iterator(lo), std::make_move_iterator(mid), std::make_move_iterator(mid),
+                           std::make_move_iterator(hi), std::back_inserter(scratch), less);
+                std::move(scratch.begin(), scratch.end(), lo);
+                changed = true;
+            }
+            bool done = !changed && !prev_changed;
+            prev_changed = changed;
+            // Every thread has read changed before it is cleared for the next phase
+            #pragma omp barrier
+            #pragma omp single
+            changed = false;
+            if (done) break;
+        }
+    }
+}
+
+// Stable radix sort of a contiguous range by an integer or floating point key;
+// radix sort only knows ascending order, so it takes no comparator
+template <typename It, typename Proj = Identity>
+void radix_sort_by(It first, It last, Proj proj = {}) {
+    static_assert(is_contiguous_iterator<It>(), "radix_sort_by needs contiguous storage");
+    if (first != last) radix_sort(&*first, size_t(last - first), proj, false);
+}
+
+template <typename It, typename Proj = Identity>
+void p_radix_sort_by(It first, It last, Proj proj = {}) {
+    static_assert(is_contiguous_iterator<It>(), "p_radix_sort_by needs contiguous storage");
+    if (first != last) radix_sort(&*first, size_t(last - first), proj, true);
+}
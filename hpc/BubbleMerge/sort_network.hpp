@@ -0,0 +1,231 @@
+#pragma once
+
+#include <limits.h>
+#include <algorithm>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+// Vectorised kernels for the bottom of the merge sorts, selected at compile
+// time: AVX2 sorts 64-element blocks in eight registers, SSE4.1 sorts
+// 16-element blocks in four, and without either (no -mavx2/-msse4.1 or
+// -march=native) everything falls back to insertion sort and a scalar merge.
+//
+// A block is sorted by running a sorting network down the register columns,
+// transposing so that every register holds a sorted run, and then bitonic
+// merging pairs of runs in registers until the block is one run. The same
+// register merge drives merge_into, which streams two sorted runs through a
+// pair of registers.
+
+#if defined(__AVX2__)
+
+struct Avx2Lanes {
+    using V = __m256i;
+    static constexpr int width = 8;
+    // 19-comparator network sorting each column across the eight registers
+    static constexpr int network_size = 19;
+    static constexpr int network[19][2] = {
+        {0, 2}, {1, 3}, {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7}, {0, 1}, {2, 3},
+        {4, 5}, {6, 7}, {2, 4}, {3, 5}, {1, 4}, {3, 6}, {1, 2}, {3, 4}, {5, 6}};
+
+    static V load(const int *p) { return _mm256_loadu_si256((const __m256i *)p); }
+    static void store(int *p, V v) { _mm256_storeu_si256((__m256i *)p, v); }
+    static V min(V a, V b) { return _mm256_min_epi32(a, b); }
+    static V max(V a, V b) { return _mm256_max_epi32(a, b); }
+    static V reverse(V v) { return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)); }
+
+    // Sort a register holding a bitonic sequence: compare lanes 4, 2, then 1 apart
+    static V clean(V v) {
+        V p = _mm256_permute2x128_si256(v, v, 1);
+        v = _mm256_blend_epi32(min(v, p), max(v, p), 0xF0);
+        p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+        v = _mm256_blend_epi32(min(v, p), max(v, p), 0xCC);
+        p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm256_blend_epi32(min(v, p), max(v, p), 0xAA);
+    }
+
+    static void transpose(V *r) {
+        __m256 t[8], s[8];
+        for (int i = 0; i < 8; i += 2) {
+            t[i] = _mm256_unpacklo_ps(_mm256_castsi256_ps(r[i]), _mm256_castsi256_ps(r[i + 1]));
+            t[i + 1] = _mm256_unpackhi_ps(_mm256_castsi256_ps(r[i]), _mm256_castsi256_ps(r[i + 1]));
+        }
+        for (int i = 0; i < 8; i += 4) {
+            s[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+            s[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+            s[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+            s[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        for (int i = 0; i < 4; i++) {
+            r[i] = _mm256_castps_si256(_mm256_permute2f128_ps(s[i], s[i + 4], 0x20));
+            r[i + 4] = _mm256_castps_si256(_mm256_permute2f128_ps(s[i], s[i + 4], 0x31));
+        }
+    }
+};
+
+using SortLanes = Avx2Lanes;
+
+#elif defined(__SSE4_1__)
+
+struct Sse4Lanes {
+    using V = __m128i;
+    static constexpr int width = 4;
+    static constexpr int network_size = 5;
+    static constexpr int network[5][2] = {{0, 1}, {2, 3}, {0, 2}, {1, 3}, {1, 2}};
+
+    static V load(const int *p) { return _mm_loadu_si128((const __m128i *)p); }
+    static void store(int *p, V v) { _mm_storeu_si128((__m128i *)p, v); }
+    static V min(V a, V b) { return _mm_min_epi32(a, b); }
+    static V max(V a, V b) { return _mm_max_epi32(a, b); }
+    static V reverse(V v) { return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)); }
+
+    // Sort a register holding a bitonic sequence: compare lanes 2, then 1 apart
+    static V clean(V v) {
+        V p = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+        v = _mm_blend_epi16(min(v, p), max(v, p), 0xF0);
+        p = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm_blend_epi16(min(v, p), max(v, p), 0xCC);
+    }
+
+    static void transpose(V *r) {
+        __m128 r0 = _mm_castsi128_ps(r[0]), r1 = _mm_castsi128_ps(r[1]);
+        __m128 r2 = _mm_castsi128_ps(r[2]), r3 = _mm_castsi128_ps(r[3]);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        r[0] = _mm_castps_si128(r0);
+        r[1] = _mm_castps_si128(r1);
+        r[2] = _mm_castps_si128(r2);
+        r[3] = _mm_castps_si128(r3);
+    }
+};
+
+using SortLanes = Sse4Lanes;
+
+#endif
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+
+// Elements sorted by one network_sort_block call
+const int network_block = SortLanes::width * SortLanes::width;
+
+// Merge the sorted runs r[0..k) and r[k..2k) into one run r[0..2k), k a power of two
+template <typename L>
+void merge_registers(typename L::V *r, int k) {
+    // Reversing the second run turns the pair into one bitonic sequence
+    std::reverse(r + k, r + 2 * k);
+    for (int i = k; i < 2 * k; i++) r[i] = L::reverse(r[i]);
+
+    for (int dist = k; dist >= 1; dist /= 2) {
+        for (int i = 0; i < 2 * k; i++) {
+            if ((i & dist) == 0) {
+                typename L::V lo = L::min(r[i], r[i + dist]);
+                r[i + dist] = L::max(r[i], r[i + dist]);
+                r[i] = lo;
+            }
+        }
+    }
+    for (int i = 0; i < 2 * k; i++) r[i] = L::clean(r[i]);
+}
+
+// Sort exactly network_block elements in registers
+template <typename L>
+void network_sort_block(int *a) {
+    typename L::V r[L::width];
+    for (int i = 0; i < L::width; i++) r[i] = L::load(a + i * L::width);
+
+    for (int c = 0; c < L::network_size; c++) {
+        int x = L::network[c][0], y = L::network[c][1];
+        typename L::V lo = L::min(r[x], r[y]);
+        r[y] = L::max(r[x], r[y]);
+        r[x] = lo;
+    }
+    L::transpose(r);
+    for (int k = 1; k < L::width; k *= 2) {
+        for (int i = 0; i < L::width; i += 2 * k) merge_registers<L>(r + i, k);
+    }
+
+    for (int i = 0; i < L::width; i++) L::store(a + i * L::width, r[i]);
+}
+
+// Stream x and y through two registers, always refilling from the run with the
+// smaller head, then finish the short tails and the held register in scalar code
+template <typename L>
+void merge_vectors(const int *x, int nx, const int *y, int ny, int *out) {
+    const int w = L::width;
+    typename L::V r[2] = {L::load(x), L::load(y)};
+    int i = w, j = w;
+    for (;;) {
+        merge_registers<L>(r, 1);
+        L::store(out, r[0]);
+        out += w;
+        bool take_x = j >= ny || (i < nx && x[i] <= y[j]);
+        if (take_x && i + w <= nx) {
+            r[0] = L::load(x + i);
+            i += w;
+        } else if (!take_x && j + w <= ny) {
+            r[0] = L::load(y + j);
+            j += w;
+        } else {
+            break;
+        }
+    }
+
+    int held[L::width];
+    L::store(held, r[1]);
+    int h = 0;
+    while (h < w || i < nx || j < ny) {
+        if (h < w && (i >= nx || held[h] <= x[i]) && (j >= ny || held[h] <= y[j])) {
+            *out++ = held[h++];
+        } else if (i < nx && (j >= ny || x[i] <= y[j])) {
+            *out++ = x[i++];
+        } else {
+            *out++ = y[j++];
+        }
+    }
+}
+
+#else
+
+const int network_block = 32;
+
+#endif
+
+// Sort a[0..n) in place; ranges up to network_block elements go through the
+// sorting network, padded with INT_MAX, anything else is insertion sorted
+inline void small_sort(int *a, int n) {
+#if defined(__AVX2__) || defined(__SSE4_1__)
+    if (n <= network_block) {
+        int block[network_block];
+        std::copy(a, a + n, block);
+        std::fill(block + n, block + network_block, INT_MAX);
+        network_sort_block<SortLanes>(block);
+        std::copy(block, block + n, a);
+        return;
+    }
+#endif
+    for (int i = 1; i < n; i++) {
+        int v = a[i];
+        int k = i - 1;
+        while (k >= 0 && a[k] > v) {
+            a[k + 1] = a[k];
+            k--;
+        }
+        a[k + 1] = v;
+    }
+}
+
+// Merge x[0..nx) and y[0..ny) into out
+inline void merge_into(const int *x, int nx, const int *y, int ny, int *out) {
+#if defined(__AVX2__) || defined(__SSE4_1__)
+    if (nx >= SortLanes::width && ny >= SortLanes::width) {
+        merge_vectors<SortLanes>(x, nx, y, ny, out);
+        return;
+    }
+#endif
+    int i = 0, j = 0, k = 0;
+    while (i < nx && j < ny) {
+        out[k++] = (y[j] < x[i]) ? y[j++] : x[i++];
+    }
+    while (i < nx) out[k++] = x[i++];
+    while (j < ny) out[k++] = y[j++];
+}
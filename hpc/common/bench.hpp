@@ -0,0 +1,233 @@
+#pragma once
+
+#include <omp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Shared benchmark harness of the hpc kernels.
+//
+// Every kernel is run a few times untimed to warm caches and the thread pool,
+// then timed over several samples with nanosecond resolution. Results are
+// reported as median, 95th percentile and standard deviation, either as
+// readable text or as CSV/JSON rows for plotting speedup curves.
+
+// Options shared by every benchmark driver, parsed from the command line:
+//
+//   --warmup=N         untimed runs before sampling (default 1)
+//   --samples=N        timed runs (default 5)
+//   --threads=1,2,4    thread counts of parallel sweeps (default 1,2,4,...,32)
+//   --format=FORMAT    text, csv or json (default text)
+//
+// Any other argument is kept, in order, in `args`.
+struct BenchOptions {
+    enum class Format { text, csv, json };
+
+    int warmup = 1;
+    int samples = 5;
+    std::vector<int> threads{1, 2, 4, 8, 16, 32};
+    Format format = Format::text;
+
+    std::vector<std::string> args;
+
+    static BenchOptions from_args(int argc, const char* const* argv) {
+        BenchOptions options;
+
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            std::string value = arg.substr(arg.find('=') + 1);
+
+            if (arg.rfind("--warmup=", 0) == 0) {
+                options.warmup = std::stoi(value);
+            } else if (arg.rfind("--samples=", 0) == 0) {
+                options.samples = std::max(1, std::stoi(value));
+            } else if (arg.rfind("--threads=", 0) == 0) {
+                options.threads.clear();
+                std::stringstream list(value);
+                for (std::string n; getline(list, n, ',');) options.threads.push_back(std::stoi(n));
+            } else if (arg.rfind("--format=", 0) == 0) {
+                if (value == "text")
+                    options.format = Format::text;
+                else if (value == "csv")
+                    options.format = Format::csv;
+                else if (value == "json")
+                    options.format = Format::json;
+                else
+                    throw std::invalid_argument("Unknown benchmark format: " + value);
+            } else {
+                options.args.push_back(arg);
+            }
+        }
+
+        return options;
+    }
+};
+
+// Summary of the timed samples of one kernel, in nanoseconds
+struct BenchResult {
+    std::string name;
+    int threads;
+    int samples;
+    double median_ns;
+    double p95_ns;
+    double mean_ns;
+    double stddev_ns;
+    double min_ns;
+};
+
+// Runs kernels and reports their timings in the format of the options
+class Bench {
+   public:
+    explicit Bench(BenchOptions options) : options(std::move(options)) {}
+
+    ~Bench() { finish(); }
+
+    const BenchOptions& config() const { return options; }
+
+    // Print an informational line. Only text reports show it, so that CSV and
+    // JSON output stay machine readable.
+    void note(const std::string& line) {
+        if (options.format == BenchOptions::Format::text) std::cout << line << "\n";
+    }
+
+    // Time a sequential kernel. `reset`, if given, runs before every run
+    // outside of the timed region, e.g. to restore the unsorted input.
+    BenchResult run(const std::string& name, const std::function<void()>& kernel,
+                    const std::function<void()>& reset = {}) {
+        return measure(name, 1, kernel, reset);
+    }
+
+    // Time `kernel` once per thread count of the options
+    std::vector<BenchResult> sweep(const std::string& name, const std::function<void()>& kernel,
+                                   const std::function<void()>& reset = {}) {
+        std::vector<BenchResult> results;
+        omp_set_dynamic(0);
+
+        for (int n : options.threads) {
+            omp_set_num_threads(n);
+            results.push_back(measure(name, n, kernel, reset));
+        }
+
+        return results;
+    }
+
+    // Flush pending output, JSON is only complete once every result is known
+    void finish() {
+        StreamFormat restore;
+
+        if (options.format == BenchOptions::Format::json && !finished) {
+            std::cout << std::fixed << std::setprecision(0) << "[\n";
+            for (size_t i = 0; i < results.size(); i++) {
+                const auto& r = results[i];
+                std::cout << "  {\"name\": \"" << r.name << "\", \"threads\": " << r.threads
+                          << ", \"samples\": " << r.samples << ", \"median_ns\": " << r.median_ns
+                          << ", \"p95_ns\": " << r.p95_ns << ", \"mean_ns\": " << r.mean_ns
+                          << ", \"stddev_ns\": " << r.stddev_ns << ", \"min_ns\": " << r.min_ns
+                          << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+            }
+            std::cout << "]" << std::endl;
+        }
+
+        finished = true;
+    }
+
+   private:
+    BenchResult measure(const std::string& name, int threads, const std::function<void()>& kernel,
+                        const std::function<void()>& reset) {
+        for (int i = 0; i < options.warmup; i++) {
+            if (reset) reset();
+            kernel();
+        }
+
+        std::vector<double> times;
+        for (int i = 0; i < options.samples; i++) {
+            if (reset) reset();
+
+            auto start = std::chrono::steady_clock::now();
+            kernel();
+            auto stop = std::chrono::steady_clock::now();
+
+            times.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+        }
+
+        BenchResult result = summarize(name, threads, times);
+        report(result);
+
+        return result;
+    }
+
+    static BenchResult summarize(const std::string& name, int threads, std::vector<double> times) {
+        std::sort(times.begin(), times.end());
+        size_t n = times.size();
+
+        double mean = 0;
+        for (double t : times) mean += t;
+        mean /= n;
+
+        double variance = 0;
+        for (double t : times) variance += (t - mean) * (t - mean);
+        variance = n > 1 ? variance / (n - 1) : 0;
+
+        // Nearest-rank percentile
+        size_t p95_rank = std::ceil(0.95 * n);
+
+        return {name,
+                threads,
+                int(n),
+                n % 2 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2,
+                times[std::max<size_t>(p95_rank, 1) - 1],
+                mean,
+                std::sqrt(variance),
+                times.front()};
+    }
+
+    void report(const BenchResult& r) {
+        StreamFormat restore;
+
+        switch (options.format) {
+            case BenchOptions::Format::text:
+                std::cout << std::fixed << std::setprecision(3) << r.name << " (" << r.threads
+                          << (r.threads == 1 ? " thread" : " threads") << "): median "
+                          << r.median_ns / 1e6 << "ms, p95 " << r.p95_ns / 1e6 << "ms, stddev "
+                          << r.stddev_ns / 1e6 << "ms\n";
+                break;
+
+            case BenchOptions::Format::csv:
+                if (results.empty())
+                    std::cout << "name,threads,samples,median_ns,p95_ns,mean_ns,stddev_ns,min_ns\n";
+                std::cout << std::fixed << std::setprecision(0) << '"' << r.name << "\","
+                          << r.threads << ',' << r.samples << ',' << r.median_ns << ','
+                          << r.p95_ns << ',' << r.mean_ns << ',' << r.stddev_ns << ','
+                          << r.min_ns << "\n";
+                break;
+
+            case BenchOptions::Format::json:
+                break;
+        }
+
+        results.push_back(r);
+    }
+
+    // Restores the formatting flags of std::cout when going out of scope
+    struct StreamFormat {
+        std::ios_base::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+
+        ~StreamFormat() {
+            std::cout.flags(flags);
+            std::cout.precision(precision);
+        }
+    };
+
+    BenchOptions options;
+    std::vector<BenchResult> results;
+    bool finished = false;
+};
@@ -0,0 +1,411 @@
+#pragma once
+
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+#include "stats.hpp"
+
+// Parallel CSV to columnar loader. The file is mapped into memory and cut into
+// one byte range per thread. Whether a range starts inside a quoted field
+// depends on everything before it, so each thread runs the field state machine
+// of split_row over its range from every possible starting state at once, and
+// chaining the resulting transitions in order gives the true state at every
+// range start without a sequential pass. A stray quote inside an unquoted field
+// is plain text to the state machine, as it is to split_row. Every thread then
+// finds the first row that starts in its range and parses its rows into
+// thread-local columns, which are concatenated in file order.
+//
+// Fields follow RFC 4180: quoted fields may hold delimiters, newlines and
+// doubled quotes, and quotes are only special at the start of a field. Every
+// column is parsed as double, with NaN for empty and non-numeric fields, and
+// thousands separators between digit groups are dropped, so "7,380,500" reads
+// as 7380500. Text is kept only for the columns that ask for it.
+
+struct CsvOptions {
+    // Field delimiter; ' ' splits on runs of spaces and tabs
+    char delimiter = ',';
+    char quote = '"';
+    // Dropped between digit groups of numeric fields, 0 to disable
+    char thousands = ',';
+    // The first row names the columns, otherwise they are column0, column1, ...
+    bool header = true;
+    // Columns whose raw text is kept next to the numeric values
+    std::vector<std::string> text_columns;
+};
+
+struct CsvColumn {
+    std::string name;
+    // One value per row, NaN where the field is empty or not a number
+    std::vector<double> values;
+    // Number of NaN values
+    size_t missing = 0;
+    // Field text per row, only for columns listed in CsvOptions::text_columns
+    std::vector<std::string> text;
+};
+
+struct CsvTable {
+    size_t rows = 0;
+    std::vector<CsvColumn> columns;
+
+    const CsvColumn &column(const std::string &name) const {
+        for (const auto &column : columns) {
+            if (column.name == name) return column;
+        }
+        throw std::invalid_argument("Unknown CSV column: " + name);
+    }
+};
+
+inline bool csv_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline std::string_view trim_field(std::string_view field) {
+    while (!field.empty() && csv_blank(field.front())) field.remove_prefix(1);
+    while (!field.empty() && csv_blank(field.back())) field.remove_suffix(1);
+    return field;
+}
+
+// Text of a field, with the doubled quotes of a quoted field undone
+inline std::string field_text(std::string_view field, bool quoted, char quote) {
+    if (!quoted) return std::string(trim_field(field));
+    std::string text;
+    text.reserve(field.size());
+    for (size_t i = 0; i < field.size(); i++) {
+        text += field[i];
+        if (field[i] == quote && i + 1 < field.size() && field[i + 1] == quote) i++;
+    }
+    return text;
+}
+
+// Numeric value of a field, NaN when it is empty or not a number
+inline double field_value(std::string_view field, char thousands) {
+    field = trim_field(field);
+    if (!field.empty() && field.front() == '+') field.remove_prefix(1);
+    auto digit = [&](size_t i) { return i < field.size() && std::isdigit((unsigned char)field[i]); };
+    char digits[64];
+    size_t n = 0;
+    for (size_t i = 0; i < field.size(); i++) {
+        char c = field[i];
+        // A separator sits between a digit and a group of exactly three digits
+        if (c == thousands && i > 0 && digit(i - 1) && digit(i + 1) && digit(i + 2) && digit(i + 3) &&
+            !digit(i + 4)) {
+            continue;
+        }
+        if (n == sizeof(digits)) return std::numeric_limits<double>::quiet_NaN();
+        digits[n++] = c;
+    }
+    if (n == 0) return std::numeric_limits<double>::quiet_NaN();
+    double value;
+    auto result = std::from_chars(digits, digits + n, value);
+    if (result.ec != std::errc() || result.ptr != digits + n) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return value;
+}
+
+// Skip lines holding nothing but blanks
+inline const char *skip_blank_lines(const char *p, const char *end) {
+    for (;;) {
+        const char *q = p;
+        while (q < end && csv_blank(*q)) q++;
+        if (q == end) return end;
+        if (*q != '\n') return p;
+        p = q + 1;
+    }
+}
+
+// Split the row starting at p into fields, calling field(index, text, quoted)
+// on each with the text between the quotes of quoted fields. Returns the start
+// of the next row
+template <typename Field>
+const char *split_row(const char *p, const char *end, const CsvOptions &options, Field &&field) {
+    bool spaces = options.delimiter == ' ';
+    auto separates = [&](char c) { return spaces ? csv_blank(c) : c == options.delimiter; };
+    if (spaces) {
+        while (p < end && csv_blank(*p)) p++;
+    }
+    for (int index = 0;; index++) {
+        const char *begin = p, *stop;
+        // Blanks before an opening quote are allowed
+        const char *open = p;
+        while (open < end && csv_blank(*open)) open++;
+        bool quoted = open < end && *open == options.quote;
+        if (quoted) {
+            begin = p = open + 1;
+            for (; p < end; p++) {
+                if (*p != options.quote) continue;
+                // A doubled quote is part of the field
+                if (p + 1 < end && p[1] == options.quote) {
+                    p++;
+                    continue;
+                }
+                break;
+            }
+            stop = p;
+            // Anything between the closing quote and the delimiter is dropped
+            while (p < end && !separates(*p) && *p != '\n') p++;
+        } else {
+            while (p < end && !separates(*p) && *p != '\n') p++;
+            stop = p;
+        }
+        field(index, std::string_view(begin, size_t(stop - begin)), quoted);
+
+        if (spaces) {
+            while (p < end && csv_blank(*p)) p++;
+        }
+        if (p == end) return end;
+        if (*p == '\n') return p + 1;
+        if (!spaces) p++;
+    }
+}
+
+// Where split_row stands after a byte: at the start of a field, inside an
+// unquoted or a quoted field, on a quote inside a quoted field that may close
+// it or be doubled, or after the closing quote
+enum CsvState : uint8_t { csv_field, csv_unquoted, csv_quoted, csv_quote, csv_closed, csv_states };
+
+// State after byte c. A newline outside quotes ends the row, and the next
+// one starts after it
+inline CsvState csv_step(CsvState state, char c, const CsvOptions &options) {
+    bool separates = options.delimiter == ' ' ? csv_blank(c) : c == options.delimiter;
+    switch (state) {
+    case csv_field:
+        if (c == '\n' || separates || csv_blank(c)) return csv_field;
+        return c == options.quote ? csv_quoted : csv_unquoted;
+    case csv_quoted:
+        return c == options.quote ? csv_quote : csv_quoted;
+    case csv_quote:
+        if (c == options.quote) return csv_quoted;
+        return c == '\n' || separates ? csv_field : csv_closed;
+    default:
+        return c == '\n' || separates ? csv_field : state;
+    }
+}
+
+// State at the end of some input for every state at its start, padded to the
+// 16 lanes of a byte shuffle
+struct alignas(16) CsvTransitions {
+    CsvState state[16];
+};
+
+// csv_step as a table indexed by byte
+inline std::vector<CsvTransitions> csv_step_table(const CsvOptions &options) {
+    std::vector<CsvTransitions> table(256);
+    for (int c = 0; c < 256; c++) {
+        for (int s = 0; s < 16; s++) {
+            table[c].state[s] = s < csv_states ? csv_step(CsvState(s), char(c), options) : CsvState(s);
+        }
+    }
+    return table;
+}
+
+// Transitions of the state machine over data[0..n). Composing the transitions
+// of a byte with those so far is a byte shuffle, so the only dependency from
+// one byte to the next is a single instruction
+inline CsvTransitions csv_transitions(const char *data, size_t n,
+                                      const std::vector<CsvTransitions> &table) {
+    CsvTransitions end;
+#if defined(__SSSE3__)
+    __m128i states = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    for (size_t i = 0; i < n; i++) {
+        __m128i step = _mm_load_si128((const __m128i *)table[(unsigned char)data[i]].state);
+        states = _mm_shuffle_epi8(step, states);
+    }
+    _mm_store_si128((__m128i *)end.state, states);
+#else
+    for (int s = 0; s < 16; s++) end.state[s] = CsvState(s);
+    for (size_t i = 0; i < n; i++) {
+        const CsvTransitions &step = table[(unsigned char)data[i]];
+        for (int s = 0; s < csv_states; s++) end.state[s] = step.state[end.state[s]];
+    }
+#endif
+    return end;
+}
+
+// Rows parsed by one thread
+struct CsvPart {
+    size_t rows = 0;
+    std::vector<std::vector<double>> values;
+    std::vector<size_t> missing;
+    std::vector<std::vector<std::string>> text;
+};
+
+inline CsvTable parse_csv(const char *data, size_t size, const CsvOptions &options = {}) {
+    CsvTable table;
+    const char *end = data + size;
+    const char *body = skip_blank_lines(data, end);
+    if (body == end) return table;
+
+    const char *second = split_row(body, end, options, [&](int i, std::string_view field, bool quoted) {
+        table.columns.emplace_back();
+        table.columns.back().name =
+            options.header ? field_text(field, quoted, options.quote) : "column" + std::to_string(i);
+    });
+    if (options.header) body = second;
+    const int ncols = int(table.columns.size());
+    std::vector<char> keep_text(ncols);
+    for (int c = 0; c < ncols; c++) {
+        const auto &wanted = options.text_columns;
+        keep_text[c] = std::find(wanted.begin(), wanted.end(), table.columns[c].name) != wanted.end();
+    }
+
+    const size_t n = size_t(end - body);
+    const int max_threads = omp_get_max_threads();
+    std::vector<CsvState> states(max_threads + 1);
+    std::vector<CsvTransitions> transitions(max_threads);
+    const std::vector<CsvTransitions> steps = csv_step_table(options);
+    std::vector<size_t> starts(max_threads + 1);
+    std::vector<CsvPart> parts(max_threads);
+    std::vector<std::exception_ptr> errors(max_threads);
+
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        size_t lo = n * t / nt, hi = n * (t + 1) / nt;
+        // The last range is never entered from its end
+        if (t + 1 < nt) transitions[t] = csv_transitions(body + lo, hi - lo, steps);
+        #pragma omp barrier
+        #pragma omp single
+        {
+            states[0] = csv_field;
+            for (int u = 1; u < nt; u++) states[u] = transitions[u - 1].state[states[u - 1]];
+            starts[nt] = n;
+        }
+
+        // The first row starting at or after lo begins after a newline outside
+        // quotes
+        size_t start = 0;
+        if (t > 0) {
+            CsvState state = states[t];
+            for (start = lo; start < n; start++) {
+                bool ends_row = body[start] == '\n' && state != csv_quoted;
+                state = steps[(unsigned char)body[start]].state[state];
+                if (ends_row) {
+                    start++;
+                    break;
+                }
+            }
+        }
+        starts[t] = start;
+        #pragma omp barrier
+
+        CsvPart &part = parts[t];
+        part.values.resize(ncols);
+        part.missing.resize(ncols);
+        part.text.resize(ncols);
+        const char *row = body + starts[t], *stop = body + starts[t + 1];
+        try {
+            while ((row = skip_blank_lines(row, stop)) < stop) {
+                int fields = 0;
+                row = split_row(row, stop, options, [&](int i, std::string_view field, bool quoted) {
+                    if (i >= ncols) {
+                        throw std::invalid_argument("CSV row has more fields than the first row.");
+                    }
+                    double value = quoted && field.find(options.quote) != std::string_view::npos
+                                       ? std::numeric_limits<double>::quiet_NaN()
+                                       : field_value(field, options.thousands);
+                    part.values[i].push_back(value);
+                    part.missing[i] += std::isnan(value);
+                    if (keep_text[i]) part.text[i].push_back(field_text(field, quoted, options.quote));
+                    fields = i + 1;
+                });
+                // Short rows are padded with empty fields
+                for (int i = fields; i < ncols; i++) {
+                    part.values[i].push_back(std::numeric_limits<double>::quiet_NaN());
+                    part.missing[i]++;
+                    if (keep_text[i]) part.text[i].emplace_back();
+                }
+                part.rows++;
+            }
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    }
+    for (const auto &error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+
+    // Concatenate the parts in file order
+    std::vector<size_t> offsets(max_threads + 1);
+    for (int t = 0; t < max_threads; t++) offsets[t + 1] = offsets[t] + parts[t].rows;
+    table.rows = offsets[max_threads];
+    for (int c = 0; c < ncols; c++) {
+        CsvColumn &column = table.columns[c];
+        column.values.resize(table.rows);
+        if (keep_text[c]) column.text.resize(table.rows);
+        for (const auto &part : parts) column.missing += part.rows > 0 ? part.missing[c] : 0;
+    }
+    #pragma omp parallel for collapse(2) schedule(dynamic)
+    for (int c = 0; c < ncols; c++) {
+        for (int t = 0; t < max_threads; t++) {
+            if (parts[t].rows == 0) continue;
+            CsvColumn &column = table.columns[c];
+            std::copy(parts[t].values[c].begin(), parts[t].values[c].end(), column.values.begin() + offsets[t]);
+            std::move(parts[t].text[c].begin(), parts[t].text[c].end(), column.text.begin() + offsets[t]);
+        }
+    }
+    return table;
+}
+
+// Map the file at path and parse it
+inline CsvTable read_csv(const std::string &path, const CsvOptions &options = {}) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::invalid_argument("CSV file does not exist or is not readable.");
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat the CSV file.");
+    }
+    size_t size = size_t(info.st_size);
+    if (size == 0) {
+        ::close(fd);
+        return {};
+    }
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Failed to map the CSV file.");
+    }
+    // Advice values are not flags, so each needs its own call. Both are only
+    // hints and the parse works the same if the kernel ignores them
+    (void)madvise(data, size, MADV_SEQUENTIAL);
+    (void)madvise(data, size, MADV_WILLNEED);
+    try {
+        CsvTable table = parse_csv(static_cast<const char *>(data), size, options);
+        munmap(data, size);
+        return table;
+    } catch (...) {
+        munmap(data, size);
+        throw;
+    }
+}
+
+// Statistics of the numeric values of a column, skipping missing ones
+inline BasicStats<double> column_stats(const CsvColumn &column) {
+    if (column.missing == 0) return p_stats(column.values.data(), int64_t(column.values.size()));
+    std::vector<double> present;
+    present.reserve(column.values.size() - column.missing);
+    std::copy_if(column.values.begin(), column.values.end(), std::back_inserter(present),
+                 [](double v) { return !std::isnan(v); });
+    return p_stats(present.data(), int64_t(present.size()));
+}
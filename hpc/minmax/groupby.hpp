@@ -0,0 +1,319 @@
+#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "../BubbleMerge/sort.hpp"
+
+// Keyed min/max/sum/count/avg of value columns, the grouped version of the
+// whole-array reductions in min_max.cpp. Keys may be of any hashable, ordered
+// type, e.g. int64_t years or std::string genres; values are double columns
+// where NaN marks a missing value, as produced by csv.hpp.
+//
+// The hash path aggregates each thread's rows into a thread-local open
+// addressing table, then partitions every table's groups by the top bits of
+// their hash so that each partition is merged by one thread without locks.
+// With many distinct keys the local tables outgrow the cache and the merge
+// moves almost every row twice, so the sort path instead stably sorts the rows
+// by key, radix sorting (key, row) pairs when radix_sort.hpp handles the key
+// type and merge sorting row numbers otherwise, and aggregates each run of
+// equal keys. Either way the groups come out sorted by key.
+
+enum class GroupByMode { automatic, hash, sort };
+
+// Aggregates of one value column within one group
+struct GroupAgg {
+    // Number of non-missing values
+    int64_t count = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double sum = 0.0;
+
+    double mean() const { return count > 0 ? sum / double(count) : 0.0; }
+
+    void add(double v) {
+        if (std::isnan(v)) return;
+        count++;
+        min = std::min(min, v);
+        max = std::max(max, v);
+        sum += v;
+    }
+
+    void merge(const GroupAgg &other) {
+        count += other.count;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        sum += other.sum;
+    }
+};
+
+template <typename Key>
+struct GroupByResult {
+    // Distinct keys in ascending order
+    std::vector<Key> keys;
+    // Rows per key
+    std::vector<int64_t> rows;
+    size_t columns = 0;
+    // Aggregates of group g and value column c at g * columns + c
+    std::vector<GroupAgg> aggs;
+    // Path that produced the result
+    GroupByMode mode = GroupByMode::automatic;
+
+    size_t size() const { return keys.size(); }
+    const GroupAgg &agg(size_t group, size_t column) const { return aggs[group * columns + column]; }
+};
+
+// Rows sampled to estimate the number of groups, and the estimate above which
+// the sort path wins because the thread-local tables no longer fit in cache
+const size_t groupby_sample = size_t(1) << 16;
+const double groupby_hash_groups = 1 << 18;
+
+// Finaliser of MurmurHash3, so that the top bits used for partitioning and
+// the low bits used for probing both depend on every bit of the key
+inline uint64_t mix_hash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+template <typename Key>
+uint64_t group_hash(const Key &key) {
+    return mix_hash(uint64_t(std::hash<Key>()(key)));
+}
+
+// Open addressing table from keys to dense group numbers, with linear probing
+// over a power of two slots kept at most half full. Groups are stored densely
+// in insertion order, so rehashing only rebuilds the slot array
+template <typename Key>
+class GroupTable {
+   public:
+    explicit GroupTable(size_t columns) : columns(columns), slots(64, empty) {}
+
+    size_t size() const { return keys.size(); }
+
+    // Group number of key, added with empty aggregates if it is new
+    size_t find_or_insert(const Key &key, uint64_t hash) {
+        size_t mask = slots.size() - 1;
+        for (size_t s = hash & mask;; s = (s + 1) & mask) {
+            if (slots[s] == empty) {
+                if (2 * (keys.size() + 1) > slots.size()) {
+                    grow();
+                    return find_or_insert(key, hash);
+                }
+                slots[s] = keys.size();
+                keys.push_back(key);
+                hashes.push_back(hash);
+                rows.push_back(0);
+                aggs.resize(aggs.size() + columns);
+                return slots[s];
+            }
+            if (hashes[slots[s]] == hash && keys[slots[s]] == key) return slots[s];
+        }
+    }
+
+    // Aggregate one row
+    void add(const Key &key, const std::vector<const double *> &values, size_t row) {
+        size_t g = find_or_insert(key, group_hash(key));
+        rows[g]++;
+        for (size_t c = 0; c < columns; c++) aggs[g * columns + c].add(values[c][row]);
+    }
+
+    // Fold group g of another table into this one
+    void merge(const GroupTable &other, size_t g) {
+        size_t mine = find_or_insert(other.keys[g], other.hashes[g]);
+        rows[mine] += other.rows[g];
+        for (size_t c = 0; c < columns; c++) aggs[mine * columns + c].merge(other.aggs[g * columns + c]);
+    }
+
+    size_t columns;
+    std::vector<Key> keys;
+    std::vector<uint64_t> hashes;
+    std::vector<int64_t> rows;
+    std::vector<GroupAgg> aggs;
+
+   private:
+    static constexpr size_t empty = ~size_t(0);
+
+    void grow() {
+        slots.assign(2 * slots.size(), empty);
+        size_t mask = slots.size() - 1;
+        for (size_t g = 0; g < keys.size(); g++) {
+            size_t s = hashes[g] & mask;
+            while (slots[s] != empty) s = (s + 1) & mask;
+            slots[s] = g;
+        }
+    }
+
+    std::vector<size_t> slots;
+};
+
+// Number of distinct keys estimated from up to groupby_sample evenly spaced
+// rows with the GEE estimator: a key seen once in the sample stands for
+// sqrt(n / sample) keys, a key seen more often for itself
+template <typename Key>
+double estimate_groups(const Key *keys, size_t n) {
+    size_t sample = std::min(n, groupby_sample);
+    if (sample == 0) return 0.0;
+    GroupTable<Key> seen(0);
+    for (size_t i = 0; i < sample; i++) {
+        const Key &key = keys[i * n / sample];
+        seen.rows[seen.find_or_insert(key, group_hash(key))]++;
+    }
+    size_t once = size_t(std::count(seen.rows.begin(), seen.rows.end(), 1));
+    return std::sqrt(double(n) / double(sample)) * double(once) + double(seen.size() - once);
+}
+
+template <typename Key>
+GroupByResult<Key> hash_group_by(const Key *keys, size_t n, const std::vector<const double *> &values) {
+    const size_t columns = values.size();
+    const int max_threads = omp_get_max_threads();
+    // A few partitions per thread balance uneven partitions
+    int bits = 0;
+    while ((1 << bits) < 4 * max_threads) bits++;
+    const size_t partitions = size_t(1) << bits;
+
+    std::vector<GroupTable<Key>> local(max_threads, GroupTable<Key>(columns));
+    // Groups of each local table ordered by partition, and where each
+    // partition starts among them
+    std::vector<std::vector<size_t>> order(max_threads);
+    std::vector<std::vector<size_t>> starts(max_threads, std::vector<size_t>(partitions + 1));
+    std::vector<GroupTable<Key>> merged(partitions, GroupTable<Key>(columns));
+    auto partition_of = [&](uint64_t hash) { return bits == 0 ? 0 : size_t(hash >> (64 - bits)); };
+
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        GroupTable<Key> &table = local[t];
+        for (size_t i = n * t / nt; i < n * (t + 1) / nt; i++) table.add(keys[i], values, i);
+
+        std::vector<size_t> &start = starts[t];
+        for (uint64_t hash : table.hashes) start[partition_of(hash) + 1]++;
+        std::partial_sum(start.begin(), start.end(), start.begin());
+        order[t].resize(table.size());
+        std::vector<size_t> fill(start.begin(), start.end() - 1);
+        for (size_t g = 0; g < table.size(); g++) order[t][fill[partition_of(table.hashes[g])]++] = g;
+        #pragma omp barrier
+
+        #pragma omp for schedule(dynamic)
+        for (size_t p = 0; p < partitions; p++) {
+            for (int u = 0; u < nt; u++) {
+                for (size_t i = starts[u][p]; i < starts[u][p + 1]; i++) merged[p].merge(local[u], order[u][i]);
+            }
+        }
+    }
+
+    // Concatenate the partitions and sort the groups by key
+    std::vector<std::pair<size_t, size_t>> groups;
+    for (size_t p = 0; p < partitions; p++) {
+        for (size_t g = 0; g < merged[p].size(); g++) groups.emplace_back(p, g);
+    }
+    p_merge_sort(groups.begin(), groups.end(), std::less<>(),
+                 [&](const std::pair<size_t, size_t> &pg) -> const Key & { return merged[pg.first].keys[pg.second]; });
+
+    GroupByResult<Key> result;
+    result.columns = columns;
+    result.mode = GroupByMode::hash;
+    result.keys.resize(groups.size());
+    result.rows.resize(groups.size());
+    result.aggs.resize(groups.size() * columns);
+    #pragma omp parallel for
+    for (size_t i = 0; i < groups.size(); i++) {
+        const GroupTable<Key> &table = merged[groups[i].first];
+        size_t g = groups[i].second;
+        result.keys[i] = table.keys[g];
+        result.rows[i] = table.rows[g];
+        std::copy(table.aggs.begin() + g * columns, table.aggs.begin() + (g + 1) * columns,
+                  result.aggs.begin() + i * columns);
+    }
+    return result;
+}
+
+// Aggregate the rows in the order of a stable sort by key, key_at(i) and
+// row_at(i) giving the key and row number of the i-th sorted row. Each thread
+// aggregates the runs of equal keys that start in its share
+template <typename Key, typename KeyAt, typename RowAt>
+GroupByResult<Key> aggregate_runs(size_t n, KeyAt key_at, RowAt row_at, const std::vector<const double *> &values) {
+    const size_t columns = values.size();
+    std::vector<GroupByResult<Key>> parts(omp_get_max_threads());
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        size_t i = n * t / nt, end = n * (t + 1) / nt;
+        while (i > 0 && i < n && key_at(i) == key_at(i - 1)) i++;
+        GroupByResult<Key> &part = parts[t];
+        while (i < end) {
+            const Key &key = key_at(i);
+            part.keys.push_back(key);
+            part.rows.push_back(0);
+            part.aggs.resize(part.aggs.size() + columns);
+            GroupAgg *agg = &part.aggs[part.aggs.size() - columns];
+            for (; i < n && key_at(i) == key; i++) {
+                size_t row = row_at(i);
+                part.rows.back()++;
+                for (size_t c = 0; c < columns; c++) agg[c].add(values[c][row]);
+            }
+        }
+    }
+
+    GroupByResult<Key> result;
+    result.columns = columns;
+    result.mode = GroupByMode::sort;
+    for (auto &part : parts) {
+        std::move(part.keys.begin(), part.keys.end(), std::back_inserter(result.keys));
+        result.rows.insert(result.rows.end(), part.rows.begin(), part.rows.end());
+        result.aggs.insert(result.aggs.end(), part.aggs.begin(), part.aggs.end());
+    }
+    return result;
+}
+
+// Key of a row next to its row number, radix sorted by key
+template <typename Key>
+struct KeyedRow {
+    Key key;
+    size_t row;
+};
+
+// The sorts are stable, so each group aggregates its rows in input order
+template <typename Key>
+GroupByResult<Key> sort_group_by(const Key *keys, size_t n, const std::vector<const double *> &values) {
+    if constexpr (is_radix_key<Key>::value) {
+        // Sorting the keys along with the rows keeps the run scan sequential
+        std::vector<KeyedRow<Key>> sorted(n);
+        #pragma omp parallel for
+        for (size_t i = 0; i < n; i++) sorted[i] = {keys[i], i};
+        p_radix_sort_by(sorted.begin(), sorted.end(), &KeyedRow<Key>::key);
+        return aggregate_runs<Key>(
+            n, [&](size_t i) -> const Key & { return sorted[i].key; }, [&](size_t i) { return sorted[i].row; },
+            values);
+    } else {
+        std::vector<size_t> order(n);
+        #pragma omp parallel for
+        for (size_t i = 0; i < n; i++) order[i] = i;
+        p_merge_sort(order.begin(), order.end(), std::less<>(),
+                     [keys](size_t row) -> const Key & { return keys[row]; });
+        return aggregate_runs<Key>(
+            n, [&](size_t i) -> const Key & { return keys[order[i]]; }, [&](size_t i) { return order[i]; }, values);
+    }
+}
+
+// Group rows 0..n) by keys[i], aggregating values[c][i] for every column c
+template <typename Key>
+GroupByResult<Key> group_by(const Key *keys, size_t n, const std::vector<const double *> &values,
+                            GroupByMode mode = GroupByMode::automatic) {
+    if (mode == GroupByMode::automatic) {
+        mode = estimate_groups(keys, n) > groupby_hash_groups ? GroupByMode::sort : GroupByMode::hash;
+    }
+    return mode == GroupByMode::hash ? hash_group_by(keys, n, values) : sort_group_by(keys, n, values);
+}
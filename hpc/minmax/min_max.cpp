@@ -1,118 +1,411 @@
+// To compile:
+// g++ -std=c++17 -O2 -march=native -fopenmp min_max.cpp -o min_max
+// To run:
+// ./min_max <array_length> <max_random_value> [--window=N] [--samples=N] [--threads=1,2,4] [--format=text|csv|json]
+// ./min_max --stream=<file|-> [--type=int|float|double] [--text] [--chunk=MB] [benchmark options]
+// ./min_max --csv=<file> [--delimiter=,|;|tab|space] [--no-header] [benchmark options]
+//           [--group-by=<column> [--group-key=text|year]] [--window=N]
+
 #include <limits.h>
 #include <omp.h>
 #include <stdlib.h>
-#include <array>
-#include <chrono>
-#include <functional>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
-using namespace std;
+#include "../common/bench.hpp"
+#include "csv.hpp"
+#include "groupby.hpp"
+#include "reduce.hpp"
+#include "scan.hpp"
+#include "select.hpp"
+#include "stats.hpp"
+#include "stream.hpp"
 
-auto start = std::chrono::high_resolution_clock::now();
-auto stop = std::chrono::high_resolution_clock::now();
-auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
+using namespace std;
 
-void s_avg(int arr[], int n) {
+double s_avg(int arr[], int n) {
     long sum = 0L;
     for (int i = 0; i < n; i++) {
         sum = sum + arr[i];
     }
-    cout << "Average: " << sum / long(n)  << endl;
+    return double(sum) / double(n);
 }
 
-void p_avg(int arr[], int n) {
+double p_avg(int arr[], int n) {
     long sum = 0L;
 
     // Parallelize summing over the array using OpenMP reduction
-    #pragma omp parallel for reduction(+ : sum) num_threads(16)
+    #pragma omp parallel for reduction(+ : sum)
     for (int i = 0; i < n; i++) {
         sum += arr[i];
     }
 
     // Compute average outside of parallel section to avoid redundant computation
-    long avg = sum / long(n);
-    cout << "Parallel Average: " << avg  << endl;
+    return double(sum) / double(n);
 }
 
-void s_sum(int arr[], int n) {
+long s_sum(int arr[], int n) {
     long sum = 0L;
     for (int i = 0; i < n; i++) {
         sum = sum + arr[i];
     }
-    cout << "Sum: " << sum << endl;
+    return sum;
 }
 
-void p_sum(int arr[], int n) {
+long p_sum(int arr[], int n) {
     long sum = 0L;
-    #pragma omp parallel for reduction(+ : sum) num_threads(16)
+    #pragma omp parallel for reduction(+ : sum)
     for (int i = 0; i < n; i++) {
         sum = sum + arr[i];
     }
-    cout << "Parallel Sum: " << sum << endl;
+    return sum;
 }
 
-void s_max(int arr[], int n) {
+int s_max(int arr[], int n) {
     int max_val = INT_MIN;
     for (int i = 0; i < n; i++) {
         if (arr[i] > max_val) {
             max_val = arr[i];
         }
     }
-    cout << "Max: " << max_val << endl;
+    return max_val;
 }
 
-void p_max(int arr[], int n) {
+int p_max(int arr[], int n) {
     int max_val = INT_MIN;
-    #pragma omp parallel for reduction(max : max_val) num_threads(16)
+    #pragma omp parallel for reduction(max : max_val)
     for (int i = 0; i < n; i++) {
         if (arr[i] > max_val) {
             max_val = arr[i];
         }
     }
-    cout << "Parallel Max: " << max_val << endl;
+    return max_val;
 }
 
-void s_min(int arr[], int n) {
+int s_min(int arr[], int n) {
     int min_val = INT_MAX;
     for (int i = 0; i < n; i++) {
         if (arr[i] < min_val) {
             min_val = arr[i];
         }
     }
-    cout << "Min: " << min_val << endl;
+    return min_val;
 }
 
-void p_min(int arr[], int n) {
+int p_min(int arr[], int n) {
     int min_val = INT_MAX;
-    #pragma omp parallel for reduction(min : min_val) num_threads(16)
+    #pragma omp parallel for reduction(min : min_val)
     for (int i = 0; i < n; i++) {
         if (arr[i] < min_val) {
             min_val = arr[i];
         }
     }
-    cout << "Parallel Min: " << min_val << endl;
+    return min_val;
+}
+
+// Reduce a column streamed from a file or standard input instead of a generated
+// array. Chunks are reduced on every thread, so both are timed as sweeps; main
+// cuts the sweep over a pipe, which can only be read once, to a single run
+template <typename T>
+void bench_stream(Bench &bench, const string &path, const StreamOptions &options) {
+    BasicStats<T> stats;
+    bench.sweep("Streaming stats", [&] { stats = stream_stats<T>(path, options); });
+    bench.note("Streamed " + (path == "-" ? string("standard input") : path) + ": count " +
+               to_string(stats.count) + ", min " + to_string(stats.min) + ", max " + to_string(stats.max) +
+               ", sum " + to_string(stats.sum) + ", mean " + to_string(stats.mean) + ", variance " +
+               to_string(stats.variance()));
+}
+
+// First run of four digits in s, e.g. 2012 in 1/3/2012, or -1 without one
+int64_t year_of(const string &s) {
+    for (size_t i = 0; i + 4 <= s.size(); i++) {
+        if (all_of(s.begin() + i, s.begin() + i + 4, [](char c) { return isdigit((unsigned char)c); })) {
+            return stoll(s.substr(i, 4));
+        }
+    }
+    return -1;
+}
+
+string key_name(const string &key) { return key; }
+string key_name(int64_t key) { return to_string(key); }
+
+// Aggregate the value columns per key with both group-by paths, then print
+// the groups of the one group_by picks
+template <typename Key>
+void bench_group_by(Bench &bench, const vector<Key> &keys, const vector<const CsvColumn *> &columns) {
+    vector<const double *> values;
+    for (const CsvColumn *column : columns) values.push_back(column->values.data());
+
+    GroupByResult<Key> result;
+    bench.sweep("Group by (hash)",
+                [&] { result = group_by(keys.data(), keys.size(), values, GroupByMode::hash); });
+    bench.sweep("Group by (sort)",
+                [&] { result = group_by(keys.data(), keys.size(), values, GroupByMode::sort); });
+    result = group_by(keys.data(), keys.size(), values);
+
+    bench.note(to_string(result.size()) + " groups, " +
+               (result.mode == GroupByMode::hash ? "hash" : "sort") + " path chosen");
+    for (size_t g = 0; g < result.size(); g++) {
+        string line = key_name(result.keys[g]) + ": rows " + to_string(result.rows[g]);
+        for (size_t c = 0; c < columns.size(); c++) {
+            const GroupAgg &agg = result.agg(g, c);
+            line += ", " + columns[c]->name + " avg " + to_string(agg.mean()) + " min " + to_string(agg.min) +
+                    " max " + to_string(agg.max) + " sum " + to_string(agg.sum);
+        }
+        bench.note(line);
+    }
+}
+
+// True when the parallel results equal the sequential ones, up to rounding
+template <typename T>
+bool same_values(const vector<T> &x, const vector<T> &y) {
+    for (size_t i = 0; i < x.size(); i++) {
+        if (abs(double(x[i]) - double(y[i])) > 1e-9 * (1.0 + abs(double(y[i])))) return false;
+    }
+    return x.size() == y.size();
+}
+
+// True when two loads of a CSV file hold the same rows, NaN matching NaN
+bool same_table(const CsvTable &x, const CsvTable &y) {
+    if (x.rows != y.rows || x.columns.size() != y.columns.size()) return false;
+    for (size_t c = 0; c < x.columns.size(); c++) {
+        const CsvColumn &a = x.columns[c], &b = y.columns[c];
+        if (a.name != b.name || a.missing != b.missing || a.text != b.text) return false;
+        for (size_t i = 0; i < x.rows; i++) {
+            if (a.values[i] != b.values[i] && !(std::isnan(a.values[i]) && std::isnan(b.values[i]))) return false;
+        }
+    }
+    return true;
+}
+
+// Prefix sums and rolling window kernels over a[0..n) with windows of w,
+// returning whether the parallel results match the sequential ones
+template <typename T>
+bool bench_windows(Bench &bench, const string &label, const T *a, size_t n, size_t w, vector<double> &mean,
+                   vector<T> &low, vector<T> &high) {
+    string suffix = " (" + label + (label.empty() ? "" : ", ") + "w=" + to_string(w) + ")";
+    size_t windows = window_count(n, w);
+    vector<SumOf<T>> scan_s(n), scan_p(n), exclusive(n);
+    vector<T> low_s(windows), high_s(windows);
+    vector<double> mean_s(windows);
+    mean.resize(windows);
+    low.resize(windows);
+    high.resize(windows);
+
+    bench.run("Sequential inclusive scan" + suffix, [&] { s_inclusive_scan(a, scan_s.data(), n); });
+    bench.sweep("Parallel inclusive scan" + suffix, [&] { p_inclusive_scan(a, scan_p.data(), n); });
+    bench.sweep("Parallel exclusive scan" + suffix, [&] { p_exclusive_scan(a, exclusive.data(), n); });
+    bench.run("Sequential window min" + suffix, [&] { s_window_min(a, n, w, low_s.data()); });
+    bench.sweep("Parallel window min" + suffix, [&] { p_window_min(a, n, w, low.data()); });
+    bench.run("Sequential window max" + suffix, [&] { s_window_max(a, n, w, high_s.data()); });
+    bench.sweep("Parallel window max" + suffix, [&] { p_window_max(a, n, w, high.data()); });
+    bench.run("Sequential rolling mean" + suffix, [&] { s_rolling_mean(a, n, w, mean_s.data()); });
+    bench.sweep("Parallel rolling mean" + suffix, [&] { p_rolling_mean(a, n, w, mean.data()); });
+
+    // The exclusive scan is the inclusive one shifted by an element
+    for (size_t i = 0; i < n; i++) exclusive[i] += a[i];
+    return same_values(scan_p, scan_s) && same_values(exclusive, scan_s) && low == low_s && high == high_s &&
+           same_values(mean, mean_s);
+}
+
+// Median, 99th percentile and top k of a[0..n): sorting a copy as the
+// baseline, introselect, parallel selection, per-thread heaps, and the KLL
+// sketch a stream would feed, which only approximates the quantiles
+template <typename T>
+void bench_select(Bench &bench, const T *a, size_t n, size_t k) {
+    const double qs[] = {0.5, 0.99};
+    vector<T> copy(a, a + n), sorted(2), exact(2), selected(2), approx(2), top_s, top_p;
+    auto reset = [&] { copy.assign(a, a + n); };
+
+    bench.run("Sequential sort for quantiles", [&] {
+        merge_sort(copy.begin(), copy.end());
+        for (int i = 0; i < 2; i++) sorted[i] = copy[quantile_rank(n, qs[i])];
+    }, reset);
+    bench.run("Sequential introselect p50/p99", [&] {
+        for (int i = 0; i < 2; i++) {
+            size_t rank = quantile_rank(n, qs[i]);
+            s_nth_element(copy.data(), n, rank);
+            exact[i] = copy[rank];
+        }
+    }, reset);
+    bench.sweep("Parallel select p50/p99", [&] {
+        for (int i = 0; i < 2; i++) selected[i] = p_quantile(a, n, qs[i]);
+    });
+    bench.run("Sequential top " + to_string(k), [&] { top_s = s_top_k(a, n, k); });
+    bench.sweep("Parallel top " + to_string(k), [&] { top_p = p_top_k(a, n, k); });
+    bench.run("Sequential KLL sketch", [&] {
+        KllSketch<T> sketch;
+        for (size_t i = 0; i < n; i++) sketch.update(a[i]);
+        for (int i = 0; i < 2; i++) approx[i] = sketch.quantile(qs[i]);
+    });
+    bench.sweep("Parallel KLL sketch", [&] {
+        KllSketch<T> sketch = p_kll_sketch(a, n);
+        for (int i = 0; i < 2; i++) approx[i] = sketch.quantile(qs[i]);
+    });
+
+    bool same = exact == sorted && selected == sorted && top_p == top_s;
+    bench.note("Quantiles: p50 " + to_string(sorted[0]) + ", p99 " + to_string(sorted[1]) + "; KLL p50 " +
+               to_string(approx[0]) + ", p99 " + to_string(approx[1]) + "; top " + to_string(k) + " from " +
+               to_string(top_s.empty() ? T() : top_s.front()) + " down to " +
+               to_string(top_s.empty() ? T() : top_s.back()));
+    bench.note(string("Selection: parallel results ") + (same ? "match" : "DIFFER FROM") + " the sorted ones");
 }
 
-std::string bench_traverse(std::function<void()> traverse_fn) {
-    auto start = std::chrono::high_resolution_clock::now();
-    traverse_fn();
-    auto stop = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
-    return std::to_string(duration.count());
+// Load a CSV file into columns and compute the statistics of every numeric
+// one, or with a group column their aggregates per key. With a window, every
+// complete column also gets its rolling mean, min and max
+void bench_csv(Bench &bench, const string &path, CsvOptions options, const string &group,
+               const string &group_key, size_t window) {
+    if (!group.empty()) options.text_columns.push_back(group);
+    CsvTable table;
+    bench.sweep("CSV load", [&] { table = read_csv(path, options); });
+    // Rows must not depend on where the thread ranges fall
+    int threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    bool consistent = same_table(read_csv(path, options), table);
+    omp_set_num_threads(threads);
+
+    vector<BasicStats<double>> stats(table.columns.size());
+    bench.sweep("CSV column stats", [&] {
+        for (size_t c = 0; c < table.columns.size(); c++) stats[c] = column_stats(table.columns[c]);
+    });
+
+    bench.note("Loaded " + path + ": " + to_string(table.rows) + " rows, " + to_string(table.columns.size()) +
+               " columns" + (consistent ? "" : ", DIFFERENT FROM A SINGLE THREAD LOAD"));
+    for (size_t c = 0; c < table.columns.size(); c++) {
+        const CsvColumn &column = table.columns[c];
+        if (stats[c].count == 0) {
+            bench.note(column.name + ": not numeric");
+            continue;
+        }
+        bench.note(column.name + ": count " + to_string(stats[c].count) + ", missing " + to_string(column.missing) +
+                   ", min " + to_string(stats[c].min) + ", max " + to_string(stats[c].max) + ", sum " +
+                   to_string(stats[c].sum) + ", mean " + to_string(stats[c].mean));
+    }
+
+    if (window > 0) bench.note("");
+    for (size_t c = 0; window > 0 && c < table.columns.size(); c++) {
+        const CsvColumn &column = table.columns[c];
+        if (column.missing > 0 || table.rows < window) continue;
+        vector<double> mean, low, high;
+        bool same = bench_windows(bench, column.name, column.values.data(), table.rows, window, mean, low, high);
+        bench.note(column.name + " last window of " + to_string(window) + ": mean " + to_string(mean.back()) +
+                   ", min " + to_string(low.back()) + ", max " + to_string(high.back()) +
+                   (same ? "" : ", PARALLEL RESULTS DIFFER"));
+    }
+
+    if (group.empty()) return;
+    const CsvColumn &key_column = table.column(group);
+    // Aggregate the columns that are mostly numbers
+    vector<const CsvColumn *> value_columns;
+    for (const CsvColumn &column : table.columns) {
+        if (2 * column.missing < table.rows && column.name != group) value_columns.push_back(&column);
+    }
+    bench.note("\nGrouped by " + group + (group_key == "year" ? " year" : ""));
+    if (group_key == "year") {
+        vector<int64_t> years(table.rows);
+        for (size_t i = 0; i < table.rows; i++) years[i] = year_of(key_column.text[i]);
+        bench_group_by(bench, years, value_columns);
+    } else if (group_key == "text") {
+        bench_group_by(bench, key_column.text, value_columns);
+    } else {
+        throw invalid_argument("Unknown group key: " + group_key);
+    }
 }
 
 int main(int argc, const char **argv) {
+    BenchOptions options = BenchOptions::from_args(argc, argv);
+
+    // Streaming and CSV mode options; anything else is positional
+    string stream_path, type = "int", csv_path, group, group_key = "text";
+    size_t window = 0;
+    StreamOptions stream;
+    CsvOptions csv;
+    vector<string> args;
+    for (const auto &arg : options.args) {
+        string value = arg.substr(arg.find('=') + 1);
+        if (arg.rfind("--stream=", 0) == 0) {
+            stream_path = value;
+        } else if (arg.rfind("--type=", 0) == 0) {
+            type = value;
+        } else if (arg == "--text") {
+            stream.text = true;
+        } else if (arg.rfind("--chunk=", 0) == 0) {
+            stream.chunk_bytes = size_t(stoul(value)) << 20;
+        } else if (arg.rfind("--csv=", 0) == 0) {
+            csv_path = value;
+        } else if (arg.rfind("--delimiter=", 0) == 0) {
+            csv.delimiter = value == "space" ? ' ' : value == "tab" ? '\t' : value[0];
+        } else if (arg == "--no-header") {
+            csv.header = false;
+        } else if (arg.rfind("--group-by=", 0) == 0) {
+            group = value;
+        } else if (arg.rfind("--group-key=", 0) == 0) {
+            group_key = value;
+        } else if (arg.rfind("--window=", 0) == 0) {
+            window = stoul(value);
+        } else {
+            args.push_back(arg);
+        }
+    }
 
+    if (!stream_path.empty()) {
+        if (stream_path == "-") {
+            // One run on every thread, or on the first count of --threads
+            bool threads_given = any_of(argv + 1, argv + argc,
+                                        [](const char *arg) { return string(arg).rfind("--threads=", 0) == 0; });
+            options.warmup = 0;
+            options.samples = 1;
+            options.threads = {threads_given ? options.threads.front() : omp_get_max_threads()};
+        }
+        Bench bench(options);
+        try {
+            if (type == "int") {
+                bench_stream<int>(bench, stream_path, stream);
+            } else if (type == "float") {
+                bench_stream<float>(bench, stream_path, stream);
+            } else if (type == "double") {
+                bench_stream<double>(bench, stream_path, stream);
+            } else {
+                throw invalid_argument("Unknown stream type: " + type);
+            }
+        } catch (const exception &ex) {
+            cerr << "Error: " << ex.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!csv_path.empty()) {
+        Bench bench(options);
+        try {
+            bench_csv(bench, csv_path, csv, group, group_key, window);
+        } catch (const exception &ex) {
+            cerr << "Error: " << ex.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    Bench bench(options);
     int n, rand_max;
 
-    // Prompt the user for array length and maximum random value
-    std::cout << "Enter array length: ";
-    std::cin >> n;
-    
-    std::cout << "Enter maximum random value: ";
-    std::cin >> rand_max;
+    if (args.size() >= 2) {
+        n = stoi(args[0]);
+        rand_max = stoi(args[1]);
+    } else {
+        // Prompt the user for array length and maximum random value
+        std::cout << "Enter array length: ";
+        std::cin >> n;
+
+        std::cout << "Enter maximum random value: ";
+        std::cin >> rand_max;
+    }
 
     // Allocate memory for the array
     int* a = new int[n];
@@ -122,41 +415,72 @@ int main(int argc, const char **argv) {
         a[i] = rand() % rand_max;  // Random values between 0 and rand_max-1
     }
 
-    // Create another array to demonstrate some processing, such as copying
-    int* b = new int[n];
-    std::copy(a, a + n, b);  // Copy elements from a to b
+    bench.note("Generated random array of length " + to_string(n) + " with elements between 0 to " +
+               to_string(rand_max) + "\n");
 
-    std::cout << "Generated random array of length " << n << " with elements between 0 to " << rand_max << "\n\n";
+    // Results are kept out of the timed kernels and printed once at the end
+    long min_val, max_val, sum;
+    double avg;
 
     // Sequential and parallel operations with timing
-    cout << "Sequential Min: " 
-          << bench_traverse([&] { s_min(a, n); }) << "ms" << endl;
+    bench.run("Sequential Min", [&] { min_val = s_min(a, n); });
+    bench.sweep("Parallel Min", [&] { min_val = p_min(a, n); });
 
-    cout << "Parallel (16) Min: " 
-            << bench_traverse([&] { p_min(a, n); }) << "ms" << endl;
+    bench.run("Sequential Max", [&] { max_val = s_max(a, n); });
+    bench.sweep("Parallel Max", [&] { max_val = p_max(a, n); });
 
-    cout << "Sequential Max: " 
-            << bench_traverse([&] { s_max(a, n); }) << "ms" << endl;
+    bench.run("Sequential Sum", [&] { sum = s_sum(a, n); });
+    bench.sweep("Parallel Sum", [&] { sum = p_sum(a, n); });
 
-    cout << "Parallel (16) Max: " 
-            << bench_traverse([&] { p_max(a, n); }) << "ms" << endl;
+    bench.run("Sequential Average", [&] { avg = s_avg(a, n); });
+    bench.sweep("Parallel Average", [&] { avg = p_avg(a, n); });
 
-    cout << "Sequential Sum: " 
-            << bench_traverse([&] { s_sum(a, n); }) << "ms" << endl;
+    // Fused kernel computing everything above, and the variance, in one pass
+    Stats stats;
+    bench.run("Sequential fused stats", [&] { stats = s_stats(a, n); });
+    bench.sweep("Parallel fused stats", [&] { stats = p_stats(a, n); });
 
-    cout << "Parallel (16) Sum: " 
-            << bench_traverse([&] { p_sum(a, n); }) << "ms" << endl;
+    // Prefix sums and rolling windows, 60 steps like the RNN notebook's sequences
+    vector<double> rolling_mean;
+    vector<int> rolling_min, rolling_max;
+    bool windows_match = bench_windows(bench, "", a, size_t(n), window > 0 ? window : 60, rolling_mean,
+                                       rolling_min, rolling_max);
 
-    cout << "Sequential Average: " 
-            << bench_traverse([&] { s_avg(a, n); }) << "ms" << endl;
+    // Quantiles and the largest elements without a full sort
+    bench_select(bench, a, size_t(n), 100);
 
-    cout << "Parallel (16) Average: " 
-            << bench_traverse([&] { p_avg(a, n); }) << "ms" << endl;
+    // Typed reductions over the same values as doubles and floats in every mode
+    vector<double> dbl(n);
+    vector<float> flt(n);
+    for (int i = 0; i < n; i++) {
+        dbl[i] = a[i] / 7.0;
+        flt[i] = float(dbl[i]);
+    }
+    const pair<SumMode, string> modes[] = {
+        {SumMode::fast, "fast"}, {SumMode::compensated, "compensated"}, {SumMode::pairwise, "pairwise"}};
+    for (const auto &mode : modes) {
+        // Keep one result per run to show which modes depend on the thread count
+        vector<double> dbl_sums, flt_sums;
+        bench.sweep("Parallel double sum (" + mode.second + ")",
+                    [&] { dbl_sums.push_back(reduce_sum(dbl.data(), n, mode.first)); });
+        bench.sweep("Parallel float sum (" + mode.second + ")",
+                    [&] { flt_sums.push_back(reduce_sum(flt.data(), n, mode.first)); });
+        bool same = count(dbl_sums.begin(), dbl_sums.end(), dbl_sums[0]) == long(dbl_sums.size()) &&
+                    count(flt_sums.begin(), flt_sums.end(), flt_sums[0]) == long(flt_sums.size());
+        bench.note("Sum (" + mode.second + "): double " + to_string(dbl_sums[0]) + ", float " +
+                   to_string(flt_sums[0]) + (same ? ", identical on every run" : ", varies between runs"));
+    }
+
+    bench.note("\nMin: " + to_string(min_val) + "\nMax: " + to_string(max_val) +
+               "\nSum: " + to_string(sum) + "\nAverage: " + to_string(avg));
+    bench.note("Fused: count " + to_string(stats.count) + ", min " + to_string(stats.min) + ", max " +
+               to_string(stats.max) + ", sum " + to_string(stats.sum) + ", mean " + to_string(stats.mean) +
+               ", variance " + to_string(stats.variance()));
+    bench.note(string("Scans and windows: parallel results ") + (windows_match ? "match" : "DIFFER FROM") +
+               " the sequential ones");
 
     // Clean up dynamically allocated memory
     delete[] a;
-    delete[] b;
 
     return 0;
 }
-
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Typed sum and mean reductions over int, int64_t, float and double arrays.
+//
+// Integer sums are exact in every mode: int input is accumulated in int64_t,
+// which cannot overflow for fewer than 2^32 elements, and int64_t input in a
+// 128-bit accumulator, throwing std::overflow_error when the total does not
+// fit back into int64_t. Floating point input is accumulated in double, in one
+// of three modes:
+//
+// - fast: an OpenMP simd reduction, free to reorder additions, so the last
+//   bits change with the thread count and the vector width.
+// - compensated: Neumaier summation in sum_lanes independent lanes per thread,
+//   with the lanes and then the threads combined by the same compensated add,
+//   so the rounding error no longer grows with n. The rounding error of each
+//   addition comes from Knuth's branch-free TwoSum, which gives the same
+//   result as Neumaier's magnitude test without a compare and blend.
+// - pairwise: the array is cut into fixed blocks of pairwise_block elements,
+//   each summed by a fixed pairwise tree, and the block sums are reduced by
+//   the same tree. Nothing depends on the number of threads, so the result is
+//   bit-identical for any thread count.
+
+enum class SumMode { fast, compensated, pairwise };
+
+// Result type of reduce_sum: int64_t for integers, double for floating point
+template <typename T>
+using SumOf = std::conditional_t<std::is_integral<T>::value, int64_t, double>;
+
+// Running Neumaier sum: sum plus the rounding error lost so far in comp
+struct CompensatedSum {
+    double sum = 0.0;
+    double comp = 0.0;
+
+    void add(double x) {
+        double t = sum + x;
+        double bp = t - sum;
+        comp += (sum - (t - bp)) + (x - bp);
+        sum = t;
+    }
+
+    void add(const CompensatedSum &other) {
+        add(other.sum);
+        add(other.comp);
+    }
+
+    double value() const { return sum + comp; }
+};
+
+// Elements per block of the pairwise mode; fixed so that the tree shape only
+// depends on n
+const int64_t pairwise_block = 4096;
+// Below this many elements the pairwise tree adds sequentially
+const int64_t pairwise_leaf = 256;
+
+// Lanes of the pairwise leaves and the compensated sum. Each lane adds its own
+// elements in a fixed order, which keeps results reproducible while letting
+// the compiler put the lanes in vector registers
+const int sum_lanes = 16;
+
+template <typename T>
+double pairwise_sum(const T *a, int64_t n) {
+    if (n <= pairwise_leaf) {
+        double lane[sum_lanes] = {};
+        int64_t i = 0;
+        for (; i + sum_lanes <= n; i += sum_lanes) {
+            for (int l = 0; l < sum_lanes; l++) lane[l] += double(a[i + l]);
+        }
+        for (; i < n; i++) lane[0] += double(a[i]);
+        for (int width = sum_lanes / 2; width >= 1; width /= 2) {
+            for (int l = 0; l < width; l++) lane[l] += lane[l + width];
+        }
+        return lane[0];
+    }
+    int64_t half = n / 2;
+    return pairwise_sum(a, half) + pairwise_sum(a + half, n - half);
+}
+
+template <typename T>
+CompensatedSum compensated_sum_range(const T *a, int64_t n) {
+    double sum[sum_lanes] = {}, comp[sum_lanes] = {};
+    int64_t i = 0;
+#if defined(__AVX2__)
+    // Same lanes as the scalar loop below, four per register
+    const int regs = sum_lanes / 4;
+    __m256d s[regs], c[regs];
+    for (int r = 0; r < regs; r++) s[r] = c[r] = _mm256_setzero_pd();
+    for (; i + sum_lanes <= n; i += sum_lanes) {
+        for (int r = 0; r < regs; r++) {
+            __m256d x;
+            if constexpr (std::is_same<T, float>::value) {
+                x = _mm256_cvtps_pd(_mm_loadu_ps(a + i + 4 * r));
+            } else {
+                x = _mm256_loadu_pd(a + i + 4 * r);
+            }
+            __m256d tv = _mm256_add_pd(s[r], x);
+            __m256d bp = _mm256_sub_pd(tv, s[r]);
+            __m256d err = _mm256_add_pd(_mm256_sub_pd(s[r], _mm256_sub_pd(tv, bp)), _mm256_sub_pd(x, bp));
+            c[r] = _mm256_add_pd(c[r], err);
+            s[r] = tv;
+        }
+    }
+    for (int r = 0; r < regs; r++) {
+        _mm256_storeu_pd(sum + 4 * r, s[r]);
+        _mm256_storeu_pd(comp + 4 * r, c[r]);
+    }
+#endif
+    for (; i + sum_lanes <= n; i += sum_lanes) {
+        for (int l = 0; l < sum_lanes; l++) {
+            double x = double(a[i + l]);
+            double t = sum[l] + x;
+            double bp = t - sum[l];
+            comp[l] += (sum[l] - (t - bp)) + (x - bp);
+            sum[l] = t;
+        }
+    }
+    CompensatedSum total;
+    for (; i < n; i++) total.add(double(a[i]));
+    for (int l = 0; l < sum_lanes; l++) {
+        total.add(sum[l]);
+        total.add(comp[l]);
+    }
+    return total;
+}
+
+template <typename T>
+double floating_sum(const T *a, int64_t n, SumMode mode, bool parallel) {
+    if (mode == SumMode::fast) {
+        double sum = 0.0;
+        #pragma omp parallel for simd reduction(+ : sum) if (parallel)
+        for (int64_t i = 0; i < n; i++) {
+            sum += double(a[i]);
+        }
+        return sum;
+    }
+
+    if (mode == SumMode::compensated) {
+        std::vector<CompensatedSum> partial(parallel ? omp_get_max_threads() : 1);
+        #pragma omp parallel if (parallel)
+        {
+            int t = omp_get_thread_num(), nt = omp_get_num_threads();
+            int64_t begin = n * t / nt, end = n * (t + 1) / nt;
+            partial[t] = compensated_sum_range(a + begin, end - begin);
+        }
+        CompensatedSum total;
+        for (const auto &part : partial) total.add(part);
+        return total.value();
+    }
+
+    int64_t blocks = (n + pairwise_block - 1) / pairwise_block;
+    std::vector<double> block_sums(blocks);
+    #pragma omp parallel for schedule(static) if (parallel)
+    for (int64_t b = 0; b < blocks; b++) {
+        int64_t begin = b * pairwise_block;
+        block_sums[b] = pairwise_sum(a + begin, std::min(pairwise_block, n - begin));
+    }
+    return pairwise_sum(block_sums.data(), blocks);
+}
+
+template <typename T>
+int64_t integer_sum(const T *a, int64_t n, bool parallel) {
+    if constexpr (sizeof(T) < sizeof(int64_t)) {
+        int64_t sum = 0;
+        #pragma omp parallel for simd reduction(+ : sum) if (parallel)
+        for (int64_t i = 0; i < n; i++) {
+            sum += a[i];
+        }
+        return sum;
+    }
+
+    __int128 total = 0;
+    #pragma omp parallel if (parallel)
+    {
+        __int128 sum = 0;
+        #pragma omp for nowait
+        for (int64_t i = 0; i < n; i++) {
+            sum += a[i];
+        }
+        #pragma omp critical(sum_update)
+        total += sum;
+    }
+    if (total > INT64_MAX || total < INT64_MIN) {
+        throw std::overflow_error("Sum does not fit in int64_t.");
+    }
+    return int64_t(total);
+}
+
+template <typename T>
+SumOf<T> reduce_sum(const T *a, int64_t n, SumMode mode = SumMode::fast, bool parallel = true) {
+    if constexpr (std::is_integral<T>::value) {
+        return integer_sum(a, n, parallel);
+    } else {
+        return floating_sum(a, n, mode, parallel);
+    }
+}
+
+// Mean as a double, without truncating integer input
+template <typename T>
+double reduce_mean(const T *a, int64_t n, SumMode mode = SumMode::fast, bool parallel = true) {
+    if (n == 0) return 0.0;
+    return double(reduce_sum(a, n, mode, parallel)) / double(n);
+}
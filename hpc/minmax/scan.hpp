@@ -0,0 +1,188 @@
+#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+// Prefix sums and sliding window kernels for time series features.
+//
+// Scans run in two passes over one contiguous block per thread: the up-sweep
+// sums each block, a scan over the block totals gives every block its
+// starting offset, and the down-sweep scans each block from that offset.
+// Sums are accumulated in U, e.g. int64_t for int input, and floating point
+// results may differ in the last bits between thread counts.
+//
+// Window kernels produce one value per full window, out[i] for the window
+// a[i..i+w), n - w + 1 values in all. Window min and max keep a monotonic
+// deque of candidate positions, so each element is pushed and popped at most
+// once; threads take contiguous ranges of windows and only repeat the w - 1
+// elements that warm up their deque. Rolling sums cut the input into blocks
+// of w: a window covers the tail of one block and the head of the next, so
+// its sum is a suffix sum of the first plus a prefix sum of the second. That
+// takes two additions per element, never subtracts, so no rounding error is
+// carried along the series, and blocks are independent.
+
+template <typename T, typename U>
+void scan(const T *in, U *out, size_t n, bool inclusive, bool parallel) {
+    std::vector<U> offsets(omp_get_max_threads() + 1);
+    #pragma omp parallel if (parallel)
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        size_t begin = n * t / nt, end = n * (t + 1) / nt;
+
+        U total = U();
+        for (size_t i = begin; i < end; i++) total += in[i];
+        offsets[t + 1] = total;
+        #pragma omp barrier
+        #pragma omp single
+        for (int u = 1; u <= nt; u++) offsets[u] += offsets[u - 1];
+
+        U running = offsets[t];
+        if (inclusive) {
+            for (size_t i = begin; i < end; i++) {
+                running += in[i];
+                out[i] = running;
+            }
+        } else {
+            for (size_t i = begin; i < end; i++) {
+                U x = in[i];
+                out[i] = running;
+                running += x;
+            }
+        }
+    }
+}
+
+// out[i] = in[0] + ... + in[i]
+template <typename T, typename U>
+void s_inclusive_scan(const T *in, U *out, size_t n) {
+    scan(in, out, n, true, false);
+}
+
+template <typename T, typename U>
+void p_inclusive_scan(const T *in, U *out, size_t n) {
+    scan(in, out, n, true, true);
+}
+
+// out[i] = in[0] + ... + in[i - 1], out[0] = 0
+template <typename T, typename U>
+void s_exclusive_scan(const T *in, U *out, size_t n) {
+    scan(in, out, n, false, false);
+}
+
+template <typename T, typename U>
+void p_exclusive_scan(const T *in, U *out, size_t n) {
+    scan(in, out, n, false, true);
+}
+
+// Number of full windows of length w over n elements
+inline size_t window_count(size_t n, size_t w) {
+    if (w == 0) {
+        throw std::invalid_argument("Window length must be positive.");
+    }
+    return n >= w ? n - w + 1 : 0;
+}
+
+// out[i] = the element of a[i..i+w) that no other one is better than
+template <typename T, typename Better>
+void window_extreme(const T *a, size_t n, size_t w, T *out, Better better, bool parallel) {
+    size_t windows = window_count(n, w);
+    // The deque never holds more than w positions; a power of two ring lets
+    // positions wrap with a mask
+    size_t capacity = 1;
+    while (capacity < w) capacity *= 2;
+    #pragma omp parallel if (parallel)
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        size_t begin = windows * t / nt, end = windows * (t + 1) / nt;
+
+        // Positions and values of the candidates for the extreme of the
+        // current window, oldest at head. Each candidate is strictly better
+        // than every later one
+        std::vector<size_t> pos(capacity);
+        std::vector<T> val(capacity);
+        size_t mask = capacity - 1, head = 0, tail = 0;
+        for (size_t i = begin; begin < end && i < end + w - 1; i++) {
+            T v = a[i];
+            if (tail > head && pos[head & mask] + w <= i) head++;
+            while (tail > head && !better(val[(tail - 1) & mask], v)) tail--;
+            pos[tail & mask] = i;
+            val[tail++ & mask] = v;
+            if (i + 1 >= begin + w) out[i + 1 - w] = val[head & mask];
+        }
+    }
+}
+
+template <typename T>
+void s_window_min(const T *a, size_t n, size_t w, T *out) {
+    window_extreme(a, n, w, out, std::less<T>(), false);
+}
+
+template <typename T>
+void p_window_min(const T *a, size_t n, size_t w, T *out) {
+    window_extreme(a, n, w, out, std::less<T>(), true);
+}
+
+template <typename T>
+void s_window_max(const T *a, size_t n, size_t w, T *out) {
+    window_extreme(a, n, w, out, std::greater<T>(), false);
+}
+
+template <typename T>
+void p_window_max(const T *a, size_t n, size_t w, T *out) {
+    window_extreme(a, n, w, out, std::greater<T>(), true);
+}
+
+// out[i] = a[i] + ... + a[i + w - 1], accumulated in U
+template <typename T, typename U>
+void rolling_sum(const T *a, size_t n, size_t w, U *out, bool parallel) {
+    size_t windows = window_count(n, w);
+    size_t blocks = (windows + w - 1) / w;
+    #pragma omp parallel for schedule(static) if (parallel)
+    for (size_t b = 0; b < blocks; b++) {
+        size_t lo = b * w, hi = std::min(lo + w, windows);
+        // Suffix sums of the block, the first of them a whole window
+        U suffix = U();
+        for (size_t i = std::min(lo + w, n); i-- > lo;) {
+            suffix += a[i];
+            if (i < hi) out[i] = suffix;
+        }
+        // The other windows reach into the next block by a prefix of it
+        U prefix = U();
+        for (size_t i = lo + 1; i < hi; i++) {
+            prefix += a[i + w - 1];
+            out[i] += prefix;
+        }
+    }
+}
+
+template <typename T, typename U>
+void s_rolling_sum(const T *a, size_t n, size_t w, U *out) {
+    rolling_sum(a, n, w, out, false);
+}
+
+template <typename T, typename U>
+void p_rolling_sum(const T *a, size_t n, size_t w, U *out) {
+    rolling_sum(a, n, w, out, true);
+}
+
+template <typename T>
+void rolling_mean(const T *a, size_t n, size_t w, double *out, bool parallel) {
+    rolling_sum(a, n, w, out, parallel);
+    size_t windows = window_count(n, w);
+    #pragma omp parallel for simd if (parallel)
+    for (size_t i = 0; i < windows; i++) out[i] /= double(w);
+}
+
+template <typename T>
+void s_rolling_mean(const T *a, size_t n, size_t w, double *out) {
+    rolling_mean(a, n, w, out, false);
+}
+
+template <typename T>
+void p_rolling_mean(const T *a, size_t n, size_t w, double *out) {
+    rolling_mean(a, n, w, out, true);
+}
@@ -0,0 +1,382 @@
+#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Selection kernels: the k-th smallest element and quantiles without sorting,
+// the k largest elements, and a mergeable sketch for approximate quantiles of
+// input that is only seen once.
+//
+// s_nth_element is an introselect: quickselect around a median of three with
+// a three-way partition, so runs of equal keys end the search, switching to
+// median of medians pivots once too many partitions leave most of the range
+// behind, which bounds the worst case to linear time. p_select narrows the
+// search in parallel first: two splitters from a sorted sample bracket the
+// wanted rank, every thread counts its block against them, and only the
+// elements of the bucket holding the rank are gathered for the next round,
+// usually a small fraction of the input. Quantiles use the nearest rank,
+// element ceil(q * n) of the sorted input.
+
+// Below this many elements selection finishes with an insertion sort
+const size_t select_insertion = 16;
+// Below this many elements p_select hands over to s_nth_element
+const size_t select_parallel_min = size_t(1) << 16;
+// Sample drawn by p_select to place its splitters
+const size_t select_sample = 4096;
+
+template <typename T>
+void select_insertion_sort(T *a, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        T v = a[i];
+        size_t j = i;
+        for (; j > 0 && v < a[j - 1]; j--) a[j] = a[j - 1];
+        a[j] = v;
+    }
+}
+
+template <typename T>
+void s_nth_element(T *a, size_t n, size_t k);
+
+// Median of the medians of groups of five, a pivot with at least 30% of the
+// range on either side
+template <typename T>
+T median_of_medians(const T *a, size_t n) {
+    std::vector<T> medians;
+    medians.reserve(n / 5 + 1);
+    T group[5];
+    for (size_t i = 0; i < n; i += 5) {
+        size_t len = std::min<size_t>(5, n - i);
+        std::copy(a + i, a + i + len, group);
+        select_insertion_sort(group, len);
+        medians.push_back(group[len / 2]);
+    }
+    s_nth_element(medians.data(), medians.size(), medians.size() / 2);
+    return medians[medians.size() / 2];
+}
+
+// Reorder a[0..n) so that a[k] is the element a sort would put there, with
+// no larger element before it and no smaller one after it
+template <typename T>
+void s_nth_element(T *a, size_t n, size_t k) {
+    if (k >= n) {
+        throw std::out_of_range("Selection rank is out of range.");
+    }
+    size_t lo = 0, hi = n;
+    // Partitions allowed to keep more than 3/4 of the range
+    int bad = 0;
+    for (size_t m = n; m > 1; m /= 2) bad++;
+
+    while (hi - lo > select_insertion) {
+        size_t m = hi - lo;
+        T pivot;
+        if (bad > 0) {
+            T x = a[lo], y = a[lo + m / 2], z = a[hi - 1];
+            pivot = std::max(std::min(x, y), std::min(std::max(x, y), z));
+        } else {
+            pivot = median_of_medians(a + lo, m);
+        }
+
+        // Three-way partition into [lo, lt) < pivot, [lt, gt) == pivot and
+        // [gt, hi) > pivot
+        size_t lt = lo, i = lo, gt = hi;
+        while (i < gt) {
+            if (a[i] < pivot) {
+                std::swap(a[lt++], a[i++]);
+            } else if (pivot < a[i]) {
+                std::swap(a[i], a[--gt]);
+            } else {
+                i++;
+            }
+        }
+
+        if (k < lt) {
+            hi = lt;
+        } else if (k >= gt) {
+            lo = gt;
+        } else {
+            return;
+        }
+        if (4 * (hi - lo) > 3 * m) bad--;
+    }
+    select_insertion_sort(a + lo, hi - lo);
+}
+
+// The k-th smallest element of a[0..n), counting from 0, leaving a unchanged
+template <typename T>
+T p_select(const T *a, size_t n, size_t k) {
+    if (k >= n) {
+        throw std::out_of_range("Selection rank is out of range.");
+    }
+    const int max_threads = omp_get_max_threads();
+    std::vector<T> current, next;
+    const T *src = a;
+    size_t m = n;
+
+    while (m > select_parallel_min) {
+        // Splitters about sqrt(sample) sample ranks either side of the
+        // wanted rank, so the middle bucket holds it with high probability
+        size_t s = std::min(m, select_sample);
+        std::vector<T> sample(s);
+        for (size_t i = 0; i < s; i++) sample[i] = src[i * m / s];
+        std::sort(sample.begin(), sample.end());
+        size_t r = size_t(double(k) / double(m) * double(s));
+        size_t margin = size_t(std::sqrt(double(s)));
+        T low = sample[r > margin ? r - margin : 0];
+        T high = sample[std::min(s - 1, r + margin)];
+
+        // Buckets: below low, within [low, high], above high
+        std::vector<size_t> counts(3 * (max_threads + 1));
+        int bucket = 0;
+        size_t before = 0, size = 0;
+        #pragma omp parallel
+        {
+            int t = omp_get_thread_num(), nt = omp_get_num_threads();
+            size_t begin = m * t / nt, end = m * (t + 1) / nt;
+            size_t below = 0, above = 0;
+            for (size_t i = begin; i < end; i++) {
+                below += src[i] < low;
+                above += high < src[i];
+            }
+            counts[3 * (t + 1)] = below;
+            counts[3 * (t + 1) + 1] = end - begin - below - above;
+            counts[3 * (t + 1) + 2] = above;
+            #pragma omp barrier
+
+            // Pick the bucket holding rank k and each thread's offset in it
+            #pragma omp single
+            {
+                size_t total[3] = {};
+                for (int u = 1; u <= nt; u++) {
+                    for (int b = 0; b < 3; b++) {
+                        size_t c = counts[3 * u + b];
+                        counts[3 * u + b] = total[b];
+                        total[b] += c;
+                    }
+                }
+                bucket = k < total[0] ? 0 : k < total[0] + total[1] ? 1 : 2;
+                before = bucket == 0 ? 0 : bucket == 1 ? total[0] : total[0] + total[1];
+                size = total[bucket];
+                next.resize(size);
+            }
+
+            size_t out = counts[3 * (t + 1) + bucket];
+            for (size_t i = begin; i < end; i++) {
+                int b = src[i] < low ? 0 : high < src[i] ? 2 : 1;
+                if (b == bucket) next[out++] = src[i];
+            }
+        }
+
+        k -= before;
+        // Every element of the middle bucket equals low when the splitters meet
+        if (bucket == 1 && !(low < high)) return low;
+        std::swap(current, next);
+        src = current.data();
+        // Unlucky splitters: finish sequentially rather than loop
+        if (4 * size > 3 * m) {
+            m = size;
+            break;
+        }
+        m = size;
+    }
+
+    if (src == a) current.assign(a, a + m);
+    s_nth_element(current.data(), m, k);
+    return current[k];
+}
+
+// Rank of the q quantile among n elements by the nearest rank method
+inline size_t quantile_rank(size_t n, double q) {
+    if (!(q >= 0.0 && q <= 1.0)) {
+        throw std::invalid_argument("Quantile must be between 0 and 1.");
+    }
+    if (n == 0) {
+        throw std::invalid_argument("Quantile of an empty array.");
+    }
+    size_t rank = size_t(std::ceil(q * double(n)));
+    return rank == 0 ? 0 : std::min(rank, n) - 1;
+}
+
+template <typename T>
+T p_quantile(const T *a, size_t n, double q) {
+    return p_select(a, n, quantile_rank(n, q));
+}
+
+// The k largest elements of a[0..n) in descending order. Each thread keeps a
+// min-heap of the k largest elements of its block, whose top is the element
+// to beat, so most elements cost a single comparison; the heaps are then
+// merged with a partial sort of their union
+template <typename T>
+std::vector<T> top_k(const T *a, size_t n, size_t k, bool parallel) {
+    k = std::min(k, n);
+    if (k == 0) return {};
+    std::vector<std::vector<T>> heaps(parallel ? omp_get_max_threads() : 1);
+    #pragma omp parallel if (parallel)
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        std::vector<T> &heap = heaps[t];
+        heap.reserve(k);
+        std::greater<T> greater;
+        for (size_t i = n * t / nt; i < n * (t + 1) / nt; i++) {
+            if (heap.size() < k) {
+                heap.push_back(a[i]);
+                std::push_heap(heap.begin(), heap.end(), greater);
+            } else if (heap.front() < a[i]) {
+                std::pop_heap(heap.begin(), heap.end(), greater);
+                heap.back() = a[i];
+                std::push_heap(heap.begin(), heap.end(), greater);
+            }
+        }
+    }
+    std::vector<T> all;
+    for (const auto &heap : heaps) all.insert(all.end(), heap.begin(), heap.end());
+    std::partial_sort(all.begin(), all.begin() + k, all.end(), std::greater<T>());
+    all.resize(k);
+    return all;
+}
+
+template <typename T>
+std::vector<T> s_top_k(const T *a, size_t n, size_t k) {
+    return top_k(a, n, k, false);
+}
+
+template <typename T>
+std::vector<T> p_top_k(const T *a, size_t n, size_t k) {
+    return top_k(a, n, k, true);
+}
+
+// KLL sketch (Karnin, Lang and Liberty) of the distribution of a stream, for
+// approximate quantiles in one pass and O(k log(n / k)) memory. Level l holds
+// items standing for 2^l inputs each. A full level is compacted: sorted, and
+// every other item, from a random first one, is promoted to the next level with
+// twice the weight. Capacities shrink by 2/3 per level below the top, so the
+// rank error stays around 1.7 / k of n. Compaction is lazy: it waits until the
+// sketch as a whole is full and then only compacts the lowest level over its
+// capacity, so level 0 soaks up many updates between sorts. Sketches of parts
+// of the input merge into a sketch of the whole, which lets threads build them
+// in parallel.
+template <typename T>
+class KllSketch {
+   public:
+    explicit KllSketch(int k = 200, uint64_t seed = 1) : k(k), rng(seed) {
+        if (k < 8) {
+            throw std::invalid_argument("KLL sketch size must be at least 8.");
+        }
+        add_level();
+    }
+
+    int64_t count() const { return n; }
+
+    size_t retained() const { return items; }
+
+    void update(T x) {
+        levels[0].push_back(x);
+        n++;
+        if (++items >= limit) compress();
+    }
+
+    void merge(const KllSketch &other) {
+        while (levels.size() < other.levels.size()) add_level();
+        for (size_t l = 0; l < other.levels.size(); l++) {
+            levels[l].insert(levels[l].end(), other.levels[l].begin(), other.levels[l].end());
+        }
+        n += other.n;
+        items += other.items;
+        compress();
+    }
+
+    // Approximate q quantile by the nearest rank method
+    T quantile(double q) const {
+        if (!(q >= 0.0 && q <= 1.0)) {
+            throw std::invalid_argument("Quantile must be between 0 and 1.");
+        }
+        if (n == 0) {
+            throw std::invalid_argument("Quantile of an empty sketch.");
+        }
+        std::vector<std::pair<T, int64_t>> weighted;
+        weighted.reserve(retained());
+        for (size_t l = 0; l < levels.size(); l++) {
+            for (T x : levels[l]) weighted.emplace_back(x, int64_t(1) << l);
+        }
+        std::sort(weighted.begin(), weighted.end());
+        // Compaction turns pairs of items into one of twice the weight, so
+        // the weights still add up to n
+        int64_t target = std::max<int64_t>(1, int64_t(std::ceil(q * double(n))));
+        int64_t seen = 0;
+        for (const auto &item : weighted) {
+            seen += item.second;
+            if (seen >= target) return item.first;
+        }
+        return weighted.back().first;
+    }
+
+   private:
+    // Add a level on top and recompute the capacities, which depend on the
+    // depth below the top
+    void add_level() {
+        levels.emplace_back();
+        capacities.resize(levels.size());
+        limit = 0;
+        for (size_t l = 0; l < levels.size(); l++) {
+            double depth = double(levels.size() - 1 - l);
+            capacities[l] = std::max<size_t>(2, size_t(std::ceil(k * std::pow(2.0 / 3.0, depth))));
+            limit += capacities[l];
+        }
+    }
+
+    // While the sketch is full some level is at or over its capacity;
+    // compact the lowest one
+    void compress() {
+        while (items >= limit) {
+            size_t l = 0;
+            while (levels[l].size() < capacities[l]) l++;
+            compact(l);
+        }
+    }
+
+    void compact(size_t l) {
+        if (l + 1 == levels.size()) add_level();
+        std::vector<T> &level = levels[l];
+        std::sort(level.begin(), level.end());
+        // An odd item out stays behind
+        size_t pairs = level.size() / 2;
+        size_t offset = rng() & 1;
+        for (size_t i = 0; i < pairs; i++) levels[l + 1].push_back(level[2 * i + offset]);
+        items -= pairs;
+        if (level.size() % 2 == 1) {
+            T last = level.back();
+            level.assign(1, last);
+        } else {
+            level.clear();
+        }
+    }
+
+    int k;
+    int64_t n = 0;
+    std::mt19937_64 rng;
+    std::vector<std::vector<T>> levels;
+    std::vector<size_t> capacities;
+    // Items retained over all levels, and the sum of the capacities
+    size_t items = 0, limit = 0;
+};
+
+// Sketch of a[0..n), one sketch per block of each thread, merged in order
+template <typename T>
+KllSketch<T> p_kll_sketch(const T *a, size_t n, int k = 200) {
+    std::vector<KllSketch<T>> parts;
+    for (int t = 0; t < omp_get_max_threads(); t++) parts.emplace_back(k, uint64_t(t) + 1);
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        for (size_t i = n * t / nt; i < n * (t + 1) / nt; i++) parts[t].update(a[i]);
+    }
+    for (size_t t = 1; t < parts.size(); t++) parts[0].merge(parts[t]);
+    return parts[0];
+}
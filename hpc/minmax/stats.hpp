@@ -0,0 +1,178 @@
+#pragma once
+
+#include <limits.h>
+#include <omp.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Summary statistics of a numeric array in one pass over memory. The array is
+// walked in L1-sized blocks: min, max and the sum of a block come from one
+// sweep, vectorised with AVX2 for int, and the squared deviations from the
+// block mean from a second sweep while the block is still in cache. Blocks,
+// and then the per-thread results, are folded together with Chan's pairwise
+// update, which keeps the variance accurate without a second trip through the
+// array. Integer sums are exact in int64_t, floating point sums are doubles.
+template <typename T>
+struct BasicStats {
+    using Sum = std::conditional_t<std::is_integral<T>::value, int64_t, double>;
+
+    int64_t count = 0;
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+    Sum sum = 0;
+    double mean = 0.0;
+    // Sum of squared deviations from the mean
+    double m2 = 0.0;
+
+    double variance() const { return count > 0 ? m2 / double(count) : 0.0; }
+    double sample_variance() const { return count > 1 ? m2 / double(count - 1) : 0.0; }
+};
+
+using Stats = BasicStats<int>;
+
+// Fold the statistics of another part of the array into acc
+template <typename T>
+void merge_stats(BasicStats<T> &acc, const BasicStats<T> &part) {
+    if (part.count == 0) return;
+    if (acc.count == 0) {
+        acc = part;
+        return;
+    }
+    int64_t count = acc.count + part.count;
+    double delta = part.mean - acc.mean;
+    acc.mean += delta * double(part.count) / double(count);
+    acc.m2 += part.m2 + delta * delta * double(acc.count) * double(part.count) / double(count);
+    acc.min = std::min(acc.min, part.min);
+    acc.max = std::max(acc.max, part.max);
+    acc.sum += part.sum;
+    acc.count = count;
+}
+
+// Elements per block, small enough for the second sweep to hit L1
+const int stats_block = 4096;
+
+#if defined(__AVX2__)
+
+inline int64_t hsum_epi64(__m256i v) {
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return _mm_cvtsi128_si64(s) + _mm_extract_epi64(s, 1);
+}
+
+inline int hmin_epi32(__m256i v) {
+    __m128i m = _mm_min_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(m);
+}
+
+inline int hmax_epi32(__m256i v) {
+    __m128i m = _mm_max_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(m);
+}
+
+#endif
+
+// Statistics of one block a[0..n), n <= stats_block
+template <typename T>
+BasicStats<T> block_stats(const T *a, int n) {
+    BasicStats<T> s;
+    s.count = n;
+    if (n == 0) return s;
+    for (int i = 0; i < n; i++) {
+        s.min = std::min(s.min, a[i]);
+        s.max = std::max(s.max, a[i]);
+        s.sum += a[i];
+    }
+    s.mean = double(s.sum) / double(n);
+    for (int i = 0; i < n; i++) {
+        double d = double(a[i]) - s.mean;
+        s.m2 += d * d;
+    }
+    return s;
+}
+
+// The int version, with the AVX2 sweeps
+template <>
+inline Stats block_stats(const int *a, int n) {
+    Stats s;
+    s.count = n;
+    if (n == 0) return s;
+    int i = 0;
+
+#if defined(__AVX2__)
+    __m256i vmin = _mm256_set1_epi32(INT_MAX), vmax = _mm256_set1_epi32(INT_MIN);
+    __m256i vsum = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+        vmin = _mm256_min_epi32(vmin, v);
+        vmax = _mm256_max_epi32(vmax, v);
+        // Widen to 64 bits so the block sum cannot overflow
+        vsum = _mm256_add_epi64(vsum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        vsum = _mm256_add_epi64(vsum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    s.min = hmin_epi32(vmin);
+    s.max = hmax_epi32(vmax);
+    s.sum = hsum_epi64(vsum);
+#endif
+    for (; i < n; i++) {
+        s.min = std::min(s.min, a[i]);
+        s.max = std::max(s.max, a[i]);
+        s.sum += a[i];
+    }
+    s.mean = double(s.sum) / double(n);
+
+    i = 0;
+#if defined(__AVX2__)
+    __m256d vmean = _mm256_set1_pd(s.mean);
+    __m256d vm2 = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(a + i))), vmean);
+        vm2 = _mm256_add_pd(vm2, _mm256_mul_pd(d, d));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, vm2);
+    s.m2 = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; i < n; i++) {
+        double d = double(a[i]) - s.mean;
+        s.m2 += d * d;
+    }
+    return s;
+}
+
+template <typename T>
+BasicStats<T> s_stats(const T *a, int64_t n) {
+    BasicStats<T> acc;
+    for (int64_t b = 0; b < n; b += stats_block) {
+        merge_stats(acc, block_stats(a + b, int(std::min<int64_t>(stats_block, n - b))));
+    }
+    return acc;
+}
+
+// Each thread folds a contiguous range of blocks; the per-thread results are
+// merged in thread order after the parallel region
+template <typename T>
+BasicStats<T> p_stats(const T *a, int64_t n) {
+    std::vector<BasicStats<T>> partial(omp_get_max_threads());
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        int64_t blocks = (n + stats_block - 1) / stats_block;
+        int64_t begin = blocks * t / nt * stats_block;
+        int64_t end = std::min(n, blocks * (t + 1) / nt * stats_block);
+        if (begin < end) partial[t] = s_stats(a + begin, end - begin);
+    }
+    BasicStats<T> acc;
+    for (const auto &part : partial) merge_stats(acc, part);
+    return acc;
+}
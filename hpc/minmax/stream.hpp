@@ -0,0 +1,186 @@
+#pragma once
+
+#include <fcntl.h>
+#include <omp.h>
+#include <unistd.h>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "stats.hpp"
+
+// Statistics of numeric columns streamed from a file or a pipe, for input too
+// large to materialise. The input is read in chunks, one buffer filling in the
+// background while all threads reduce the other, and the per-chunk results are
+// folded together with merge_stats, so memory use stays at two chunks however
+// long the input is. Binary input is a native-endian array of T; text input is
+// numbers separated by whitespace, parsed in parallel with std::from_chars.
+
+struct StreamOptions {
+    // Bytes per chunk; two chunks are in memory at a time
+    size_t chunk_bytes = size_t(32) << 20;
+    // Whitespace separated text instead of raw binary values
+    bool text = false;
+};
+
+// Longest number accepted in text input, in bytes
+const size_t stream_max_token = 4096;
+
+// Read up to count bytes, returning fewer only at the end of the input. Pipes
+// return whatever is available, so keep reading until the buffer is full
+inline size_t read_fully(int fd, char *data, size_t count) {
+    size_t got = 0;
+    while (got < count) {
+        ssize_t r = ::read(fd, data + got, count - got);
+        if (r == 0) break;
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to read from the input stream.");
+        }
+        got += size_t(r);
+    }
+    return got;
+}
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Parse the single number in [first, last)
+template <typename T>
+T parse_number(const char *first, const char *last) {
+    T value;
+    auto result = std::from_chars(first, last, value);
+    if (result.ec != std::errc() || result.ptr != last) {
+        throw std::invalid_argument("Malformed number in text input: " + std::string(first, last));
+    }
+    return value;
+}
+
+// Statistics of the numbers in text[0..n), which starts and ends on token
+// boundaries. Each thread takes the tokens that start in its share of the
+// bytes, parses them into a block of stats_block values and folds full blocks
+// with block_stats, so nothing larger than a block is ever materialised
+template <typename T>
+BasicStats<T> p_text_stats(const char *text, size_t n) {
+    std::vector<BasicStats<T>> partial(omp_get_max_threads());
+    // Exceptions cannot leave a parallel region, so they are rethrown after it
+    std::vector<std::exception_ptr> errors(partial.size());
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        size_t pos = n * t / nt, end = n * (t + 1) / nt;
+        // A token straddling the start of the share belongs to the previous thread
+        while (pos > 0 && pos < n && !is_space(text[pos - 1])) pos++;
+        try {
+            std::vector<T> block(stats_block);
+            int fill = 0;
+            for (;;) {
+                while (pos < n && is_space(text[pos])) pos++;
+                if (pos >= end) break;
+                size_t stop = pos;
+                while (stop < n && !is_space(text[stop])) stop++;
+                block[fill++] = parse_number<T>(text + pos, text + stop);
+                pos = stop;
+                if (fill == stats_block) {
+                    merge_stats(partial[t], block_stats(block.data(), fill));
+                    fill = 0;
+                }
+            }
+            merge_stats(partial[t], block_stats(block.data(), fill));
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    }
+    for (const auto &error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+    BasicStats<T> acc;
+    for (const auto &part : partial) merge_stats(acc, part);
+    return acc;
+}
+
+// Stream fd to its end. In text mode the token cut off at the end of a chunk
+// is carried over and completed with the start of the next one
+template <typename T>
+BasicStats<T> stream_stats(int fd, const StreamOptions &options = {}) {
+    size_t chunk = std::max(sizeof(T), options.chunk_bytes);
+    if (!options.text) chunk = chunk / sizeof(T) * sizeof(T);
+
+    // Left uninitialised, the reads overwrite them anyway
+    std::unique_ptr<char[]> bufs[2];
+    for (auto &buf : bufs) buf.reset(new char[chunk]);
+    auto read_chunk = [&](int b) {
+        return std::async(std::launch::async, [&, b] { return read_fully(fd, bufs[b].get(), chunk); });
+    };
+
+    BasicStats<T> acc;
+    std::string carry;
+    auto fold_carry = [&] {
+        if (carry.empty()) return;
+        T value = parse_number<T>(carry.data(), carry.data() + carry.size());
+        merge_stats(acc, block_stats(&value, 1));
+        carry.clear();
+    };
+
+    std::future<size_t> reading = read_chunk(0);
+    for (int b = 0;; b ^= 1) {
+        size_t got = reading.get();
+        if (got == 0) break;
+        // The other buffer was fully reduced in the previous iteration
+        reading = read_chunk(b ^ 1);
+        const char *data = bufs[b].get();
+
+        if (!options.text) {
+            // Only the last chunk can be short
+            if (got % sizeof(T) != 0) {
+                throw std::invalid_argument("Input size is not a multiple of the element size.");
+            }
+            merge_stats(acc, p_stats(reinterpret_cast<const T *>(data), int64_t(got / sizeof(T))));
+            continue;
+        }
+
+        size_t begin = 0;
+        while (begin < got && !is_space(data[begin])) begin++;
+        carry.append(data, begin);
+        if (carry.size() > stream_max_token) {
+            throw std::invalid_argument("Token in text input is too long to be a number.");
+        }
+        if (begin == got) continue;
+        fold_carry();
+
+        size_t end = got;
+        while (!is_space(data[end - 1])) end--;
+        merge_stats(acc, p_text_stats<T>(data + begin, end - begin));
+        carry.assign(data + end, got - end);
+    }
+    fold_carry();
+    return acc;
+}
+
+// Stream the file at path, or standard input when path is "-"
+template <typename T>
+BasicStats<T> stream_stats(const std::string &path, const StreamOptions &options = {}) {
+    if (path == "-") return stream_stats<T>(STDIN_FILENO, options);
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::invalid_argument("Input file does not exist or is not readable.");
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    try {
+        BasicStats<T> stats = stream_stats<T>(fd, options);
+        ::close(fd);
+        return stats;
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}